@@ -0,0 +1,160 @@
+#include "../fuzzing/expression_generator.hpp"
+#include "../parser.hpp"
+#include "../precompiled.hpp"
+#include "../scanner.hpp"
+#include "../utils.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Measures the warm start of a worker that has to get a large number of stored formulas into an evaluable
+ * state: reading and parsing the formula text (tokenize() + Parser::parse()) vs. mapping a precompiled file.
+ *
+ * usage: kalkumulator_startup_benchmark [--cases N] [--repetitions N]
+ */
+
+namespace {
+    // what a worker has to keep alive after parsing: the syntax trees refer to the source text
+    struct ParsedFormulas {
+        std::vector<std::unique_ptr<const std::string>> sources;
+        std::vector<std::unique_ptr<Expression>> expressions;
+    };
+
+    [[nodiscard]] ParsedFormulas parse_file(const std::filesystem::path& path) {
+        auto result = ParsedFormulas{};
+        auto file = std::ifstream{ path };
+        auto line = std::string{};
+        while (std::getline(file, line)) {
+            auto& source = result.sources.emplace_back(std::make_unique<const std::string>(std::move(line)));
+            auto parser = Parser{ *source, std::move(*tokenize(*source)) };
+            result.expressions.push_back(parser.parse());
+        }
+        return result;
+    }
+
+    /* evaluates all formulas in order against one symbol table and returns the (wrapped around) sum of all
+     * results, evaluation errors count as 0 */
+    template<typename Evaluate>
+    [[nodiscard]] u64 evaluate_all(const usize count, Evaluate&& evaluate) {
+        auto symbol_table = SymbolTable{};
+        auto sum = u64{ 0 };
+        for (usize i = 0; i < count; ++i) {
+            try {
+                sum += static_cast<u64>(evaluate(i, symbol_table));
+            } catch (const EvaluationError&) { }
+        }
+        return sum;
+    }
+
+    template<typename Function>
+    [[nodiscard]] double best_milliseconds(const usize repetitions, Function&& function) {
+        auto best = std::chrono::duration<double, std::milli>::max();
+        for (usize i = 0; i < repetitions; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto elapsed = std::chrono::duration<double, std::milli>{ std::chrono::steady_clock::now() - start };
+            best = std::min(best, elapsed);
+        }
+        return best.count();
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    usize case_count = 5000;
+    usize repetitions = 5;
+    auto valid_arguments = (argc % 2 == 1);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const auto argument = std::string_view{ argv[i] };
+        const auto value = static_cast<usize>(std::strtoull(argv[i + 1], nullptr, 10));
+        if (argument == "--cases") {
+            case_count = value;
+        } else if (argument == "--repetitions") {
+            repetitions = std::max(value, usize{ 1 });
+        } else {
+            valid_arguments = false;
+        }
+    }
+    if (not valid_arguments) {
+        std::cerr << "usage: " << argv[0] << " [--cases N] [--repetitions N]\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto text_path = directory / "kalkumulator_startup_benchmark.txt";
+    const auto precompiled_path = directory / "kalkumulator_startup_benchmark.kalk";
+    usize formula_count = 0;
+    {
+        // every generated case consists of the variable definitions followed by the actual expression
+        auto generator = ExpressionGenerator{ GeneratorOptions{ .max_depth = 5, .max_width = 4 }, 42 };
+        auto text_file = std::ofstream{ text_path };
+        for (usize i = 0; i < case_count; ++i) {
+            for (const auto& line : generator.generate().lines) {
+                text_file << line << "\n";
+                ++formula_count;
+            }
+        }
+    }
+    {
+        auto writer = PrecompiledWriter{};
+        const auto parsed = parse_file(text_path);
+        for (const auto& expression : parsed.expressions) {
+            writer.add(*expression);
+        }
+        const auto bytes = writer.serialize();
+        auto precompiled_file = std::ofstream{ precompiled_path, std::ios::binary };
+        precompiled_file.write(
+                reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())
+        );
+    }
+
+    const auto parse_milliseconds = best_milliseconds(repetitions, [&] {
+        const auto parsed = parse_file(text_path);
+        if (parsed.expressions.size() != formula_count) {
+            std::abort();
+        }
+    });
+    const auto load_milliseconds = best_milliseconds(repetitions, [&] {
+        const auto file = PrecompiledFile{ precompiled_path.string() };
+        if (file.view().formula_count() != formula_count) {
+            std::abort();
+        }
+    });
+
+    const auto parsed = parse_file(text_path);
+    const auto precompiled = PrecompiledFile{ precompiled_path.string() };
+    auto parsed_sum = u64{ 0 };
+    auto precompiled_sum = u64{ 0 };
+    const auto parsed_evaluation_milliseconds = best_milliseconds(repetitions, [&] {
+        parsed_sum = evaluate_all(formula_count, [&](const usize index, SymbolTable& symbol_table) {
+            return parsed.expressions.at(index)->evaluate(symbol_table);
+        });
+    });
+    const auto precompiled_evaluation_milliseconds = best_milliseconds(repetitions, [&] {
+        precompiled_sum = evaluate_all(formula_count, [&](const usize index, SymbolTable& symbol_table) {
+            return precompiled.view().formula(index).evaluate(symbol_table);
+        });
+    });
+
+    std::cout << formula_count << " formulas, " << std::filesystem::file_size(text_path) << " bytes as text, "
+              << std::filesystem::file_size(precompiled_path) << " bytes precompiled\n\n"
+              << std::left << std::setw(14) << "" << std::right << std::setw(14) << "startup [ms]" << std::setw(18)
+              << "evaluate all [ms]" << "\n"
+              << std::fixed << std::setprecision(3) << std::left << std::setw(14) << "parse" << std::right
+              << std::setw(14) << parse_milliseconds << std::setw(18) << parsed_evaluation_milliseconds << "\n"
+              << std::left << std::setw(14) << "precompiled" << std::right << std::setw(14) << load_milliseconds
+              << std::setw(18) << precompiled_evaluation_milliseconds << "\n";
+
+    std::filesystem::remove(text_path);
+    std::filesystem::remove(precompiled_path);
+    if (parsed_sum != precompiled_sum) {
+        std::cerr << "results of parsed and precompiled formulas differ\n";
+        return EXIT_FAILURE;
+    }
+}
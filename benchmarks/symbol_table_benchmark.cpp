@@ -0,0 +1,257 @@
+#include "../parser.hpp"
+#include "../scanner.hpp"
+#include "../utils.hpp"
+#include "../versioned_symbol_table.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Measures how well read-only evaluations scale with the number of reader threads while one writer thread
+ * keeps applying assignments to the shared symbol table. Compares a global mutex (the current way of sharing
+ * a SymbolTable), a reader-writer lock and the VersionedSymbolTable.
+ *
+ * usage: kalkumulator_symbol_table_benchmark [--max-threads N] [--duration-ms N] [--write-interval-us N]
+ */
+
+namespace {
+    constexpr usize variable_count = 100;
+
+    // sink for the results of all evaluations so that they cannot be optimized away
+    std::atomic<i64> checksum_sink{ 0 };
+
+    struct Settings {
+        usize max_threads{ std::max(std::thread::hardware_concurrency(), 1U) };
+        std::chrono::milliseconds duration{ 500 };
+        std::chrono::microseconds write_interval{ 10 };
+    };
+
+    // keeps the source text alive (at a stable address) since the syntax tree refers to it
+    struct Formula {
+        std::unique_ptr<const std::string> source;
+        std::unique_ptr<Expression> expression;
+
+        explicit Formula(std::string text) : source{ std::make_unique<const std::string>(std::move(text)) } {
+            auto parser = Parser{ *source, std::move(*tokenize(*source)) };
+            expression = parser.parse();
+        }
+    };
+
+    struct MutexTable {
+        std::mutex mutex;
+        SymbolTable symbols;
+
+        [[nodiscard]] MutexTable& reader() {
+            return *this;
+        }
+
+        [[nodiscard]] i64 read(const Expression& formula) {
+            const auto lock = std::scoped_lock{ mutex };
+            return formula.evaluate_read_only(symbols);
+        }
+
+        void write(const Expression& assignment) {
+            const auto lock = std::scoped_lock{ mutex };
+            static_cast<void>(assignment.evaluate(symbols));
+        }
+    };
+
+    struct SharedMutexTable {
+        std::shared_mutex mutex;
+        SymbolTable symbols;
+
+        [[nodiscard]] SharedMutexTable& reader() {
+            return *this;
+        }
+
+        [[nodiscard]] i64 read(const Expression& formula) {
+            const auto lock = std::shared_lock{ mutex };
+            return formula.evaluate_read_only(symbols);
+        }
+
+        void write(const Expression& assignment) {
+            const auto lock = std::unique_lock{ mutex };
+            static_cast<void>(assignment.evaluate(symbols));
+        }
+    };
+
+    // takes a new snapshot for every evaluation
+    struct VersionedTable {
+        VersionedSymbolTable table;
+
+        [[nodiscard]] VersionedTable& reader() {
+            return *this;
+        }
+
+        [[nodiscard]] i64 read(const Expression& formula) const {
+            const auto snapshot = table.snapshot();
+            return formula.evaluate_read_only(snapshot->symbols);
+        }
+
+        void write(const Expression& assignment) {
+            static_cast<void>(table.apply(assignment));
+        }
+    };
+
+    // every reading thread keeps its snapshot until a new version is published
+    struct VersionedReaderTable {
+        struct Reader {
+            VersionedSymbolTable::Reader reader;
+
+            [[nodiscard]] i64 read(const Expression& formula) {
+                return formula.evaluate_read_only(reader.symbols());
+            }
+        };
+
+        VersionedSymbolTable table;
+
+        [[nodiscard]] Reader reader() const {
+            return Reader{ table.reader() };
+        }
+
+        void write(const Expression& assignment) {
+            static_cast<void>(table.apply(assignment));
+        }
+    };
+
+    struct Result {
+        u64 reads;
+        u64 writes;
+    };
+
+    [[nodiscard]] SymbolTable initial_symbols() {
+        auto symbols = SymbolTable{};
+        for (usize i = 0; i < variable_count; ++i) {
+            symbols[concatenate("v", std::to_string(i))] = static_cast<i64>(i);
+        }
+        return symbols;
+    }
+
+    template<typename Table>
+    [[nodiscard]] Result run(
+            Table& table,
+            const usize reader_count,
+            const Formula& formula,
+            const std::vector<Formula>& assignments,
+            const Settings& settings
+    ) {
+        auto start = std::atomic<bool>{ false };
+        auto stop = std::atomic<bool>{ false };
+        auto reads = std::atomic<u64>{ 0 };
+        auto writes = u64{ 0 };
+
+        auto readers = std::vector<std::jthread>{};
+        for (usize i = 0; i < reader_count; ++i) {
+            readers.emplace_back([&] {
+                decltype(auto) reader = table.reader();
+                while (not start.load()) { }
+                auto local_reads = u64{ 0 };
+                auto checksum = i64{ 0 };
+                while (not stop.load(std::memory_order_relaxed)) {
+                    checksum += reader.read(*formula.expression);
+                    ++local_reads;
+                }
+                reads += local_reads;
+                checksum_sink.fetch_add(checksum, std::memory_order_relaxed);
+            });
+        }
+        auto writer = std::jthread{ [&] {
+            while (not start.load()) { }
+            while (not stop.load(std::memory_order_relaxed)) {
+                table.write(*assignments.at(writes % assignments.size()).expression);
+                ++writes;
+                std::this_thread::sleep_for(settings.write_interval);
+            }
+        } };
+
+        start = true;
+        std::this_thread::sleep_for(settings.duration);
+        stop = true;
+        readers.clear();
+        writer.join();
+        return Result{ reads.load(), writes };
+    }
+
+    // powers of two up to (and always including) the maximum, e.g. 1, 2, 4, 6 for 6 cores
+    [[nodiscard]] std::vector<usize> reader_counts(const usize max_threads) {
+        auto result = std::vector<usize>{};
+        for (usize reader_count = 1; reader_count < max_threads; reader_count *= 2) {
+            result.push_back(reader_count);
+        }
+        result.push_back(max_threads);
+        return result;
+    }
+
+    template<typename Table>
+    void benchmark(
+            const std::string_view name,
+            const Formula& formula,
+            const std::vector<Formula>& assignments,
+            const Settings& settings
+    ) {
+        for (const auto reader_count : reader_counts(settings.max_threads)) {
+            auto table = std::make_unique<Table>();
+            if constexpr (requires { table->table; }) {
+                table->table.update([](SymbolTable& symbols) { symbols = initial_symbols(); });
+            } else {
+                table->symbols = initial_symbols();
+            }
+            const auto [reads, writes] = run(*table, reader_count, formula, assignments, settings);
+            const auto seconds = std::chrono::duration<double>{ settings.duration }.count();
+            const auto reads_per_second = static_cast<double>(reads) / seconds;
+            std::cout << std::left << std::setw(14) << name << std::right << std::setw(8) << reader_count
+                      << std::setw(16) << std::fixed << std::setprecision(0) << reads_per_second << std::setw(16)
+                      << (reads_per_second / static_cast<double>(reader_count)) << std::setw(12)
+                      << (static_cast<double>(writes) / seconds) << "\n";
+        }
+    }
+
+    [[nodiscard]] bool parse_arguments(const int argc, char** const argv, Settings& settings) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            const auto argument = std::string_view{ argv[i] };
+            const auto value = std::strtoull(argv[i + 1], nullptr, 10);
+            if (argument == "--max-threads") {
+                settings.max_threads = std::max(static_cast<usize>(value), usize{ 1 });
+            } else if (argument == "--duration-ms") {
+                settings.duration = std::chrono::milliseconds{ value };
+            } else if (argument == "--write-interval-us") {
+                settings.write_interval = std::chrono::microseconds{ value };
+            } else {
+                return false;
+            }
+        }
+        return argc % 2 == 1;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    auto settings = Settings{};
+    if (not parse_arguments(argc, argv, settings)) {
+        std::cerr << "usage: " << argv[0] << " [--max-threads N] [--duration-ms N] [--write-interval-us N]\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto formula =
+            Formula{ "(v1 + v2 * v3 - v4) / (v5 + 1) + v10 * (v20 - v30) + (v40 + v50) * v60 / (v70 + 1)" };
+    auto assignments = std::vector<Formula>{};
+    for (usize i = 0; i < variable_count; ++i) {
+        const auto variable = concatenate("v", std::to_string(i));
+        assignments.emplace_back(concatenate(variable, " = ", variable, " + 1"));
+    }
+
+    std::cout << std::left << std::setw(14) << "table" << std::right << std::setw(8) << "readers" << std::setw(16)
+              << "reads/s" << std::setw(16) << "reads/s/thread" << std::setw(12) << "writes/s" << "\n";
+    benchmark<MutexTable>("mutex", formula, assignments, settings);
+    benchmark<SharedMutexTable>("shared_mutex", formula, assignments, settings);
+    benchmark<VersionedTable>("versioned", formula, assignments, settings);
+    benchmark<VersionedReaderTable>("reader", formula, assignments, settings);
+}
@@ -7,11 +7,15 @@
 #include "error.hpp"
 #include "types.hpp"
 #include <cassert>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 struct EvaluationError final : public std::exception {
     std::string error_message;
@@ -19,7 +23,16 @@ struct EvaluationError final : public std::exception {
     explicit EvaluationError(std::string error_message) : error_message{ std::move(error_message) } { }
 };
 
-using SymbolTable = std::unordered_map<std::string, i64>;
+// allows looking up variables by their std::string_view name without creating a std::string first
+struct SymbolTableHash {
+    using is_transparent = void;
+
+    [[nodiscard]] usize operator()(const std::string_view name) const {
+        return std::hash<std::string_view>{}(name);
+    }
+};
+
+using SymbolTable = std::unordered_map<std::string, i64, SymbolTableHash, std::equal_to<>>;
 
 enum class BinaryOperatorType {
     Add,
@@ -33,11 +46,43 @@ enum class UnaryOperatorType {
     Minus,
 };
 
+struct IntegerValue;
+struct BinaryOperator;
+struct UnaryOperator;
+struct Assignment;
+struct Variable;
+
+// extension point for operations on the syntax tree that are not part of the Expression interface itself
+struct ExpressionVisitor {
+    virtual ~ExpressionVisitor() = default;
+    virtual void visit(const IntegerValue&) = 0;
+    virtual void visit(const BinaryOperator&) = 0;
+    virtual void visit(const UnaryOperator&) = 0;
+    virtual void visit(const Assignment&) = 0;
+    virtual void visit(const Variable&) = 0;
+};
+
 struct Expression {
 public:
     virtual ~Expression() = default;
+    virtual void accept(ExpressionVisitor& visitor) const = 0;
     [[nodiscard]] virtual std::string to_string() const = 0;
     [[nodiscard]] virtual i64 evaluate(SymbolTable&) const = 0;
+    /* evaluation against a table that must not be modified (e.g. a snapshot of a VersionedSymbolTable).
+     * Assignments are rejected, but only after their value has been evaluated: errors are reported in the
+     * same order as by evaluate() (e.g. "x = 1 / 0" still results in a divide by zero error) */
+    [[nodiscard]] virtual i64 evaluate_read_only(const SymbolTable&) const = 0;
+
+protected:
+    // evaluates a sub-expression in the same mode (read-only or not) as its parent
+    template<typename Table>
+    [[nodiscard]] static i64 evaluate_sub_expression(const Expression& sub_expression, Table& symbol_table) {
+        if constexpr (std::is_const_v<Table>) {
+            return sub_expression.evaluate_read_only(symbol_table);
+        } else {
+            return sub_expression.evaluate(symbol_table);
+        }
+    }
 };
 
 struct IntegerValue final : public Expression {
@@ -47,6 +92,14 @@ private:
 public:
     explicit IntegerValue(u32 value) : m_value{ value } { }
 
+    [[nodiscard]] u32 value() const {
+        return m_value;
+    }
+
+    void accept(ExpressionVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
     [[nodiscard]] std::string to_string() const override {
         return std::to_string(m_value);
     }
@@ -54,6 +107,10 @@ public:
     [[nodiscard]] i64 evaluate(SymbolTable&) const override {
         return static_cast<i64>(m_value);
     }
+
+    [[nodiscard]] i64 evaluate_read_only(const SymbolTable&) const override {
+        return static_cast<i64>(m_value);
+    }
 };
 
 struct BinaryOperator final : public Expression {
@@ -68,6 +125,22 @@ public:
           m_operator_type{ operator_type },
           m_rhs{ std::move(rhs) } { }
 
+    [[nodiscard]] const Expression& lhs() const {
+        return *m_lhs;
+    }
+
+    [[nodiscard]] BinaryOperatorType operator_type() const {
+        return m_operator_type;
+    }
+
+    [[nodiscard]] const Expression& rhs() const {
+        return *m_rhs;
+    }
+
+    void accept(ExpressionVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
     [[nodiscard]] std::string to_string() const override {
         using namespace std::string_literals;
 
@@ -95,9 +168,18 @@ public:
     }
 
     [[nodiscard]] i64 evaluate(SymbolTable& symbol_table) const override {
-        using namespace std::string_view_literals;
-        const auto left = m_lhs->evaluate(symbol_table);
-        const auto right = m_rhs->evaluate(symbol_table);
+        return evaluate_impl(symbol_table);
+    }
+
+    [[nodiscard]] i64 evaluate_read_only(const SymbolTable& symbol_table) const override {
+        return evaluate_impl(symbol_table);
+    }
+
+private:
+    template<typename Table>
+    [[nodiscard]] i64 evaluate_impl(Table& symbol_table) const {
+        const auto left = evaluate_sub_expression(*m_lhs, symbol_table);
+        const auto right = evaluate_sub_expression(*m_rhs, symbol_table);
         switch (m_operator_type) {
             case BinaryOperatorType::Add:
                 return left + right;
@@ -127,6 +209,18 @@ public:
         : m_operator_type{ operator_type },
           m_sub_expression{ std::move(sub_expression) } { }
 
+    [[nodiscard]] UnaryOperatorType operator_type() const {
+        return m_operator_type;
+    }
+
+    [[nodiscard]] const Expression& sub_expression() const {
+        return *m_sub_expression;
+    }
+
+    void accept(ExpressionVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
     [[nodiscard]] std::string to_string() const override {
         using namespace std::string_literals;
         const auto operator_text = [&]() -> std::string {
@@ -147,7 +241,17 @@ public:
     }
 
     [[nodiscard]] i64 evaluate(SymbolTable& symbol_table) const override {
-        const auto sub_expression_value = m_sub_expression->evaluate(symbol_table);
+        return evaluate_impl(symbol_table);
+    }
+
+    [[nodiscard]] i64 evaluate_read_only(const SymbolTable& symbol_table) const override {
+        return evaluate_impl(symbol_table);
+    }
+
+private:
+    template<typename Table>
+    [[nodiscard]] i64 evaluate_impl(Table& symbol_table) const {
+        const auto sub_expression_value = evaluate_sub_expression(*m_sub_expression, symbol_table);
         switch (m_operator_type) {
             case UnaryOperatorType::Plus:
                 return sub_expression_value;
@@ -170,6 +274,18 @@ public:
         : m_variable_name{ variable_name },
           m_value{ std::move(value) } { }
 
+    [[nodiscard]] std::string_view variable_name() const {
+        return m_variable_name;
+    }
+
+    [[nodiscard]] const Expression& value() const {
+        return *m_value;
+    }
+
+    void accept(ExpressionVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
     [[nodiscard]] std::string to_string() const override {
         return std::string{ m_variable_name };
     }
@@ -179,6 +295,12 @@ public:
         symbol_table[std::string{ m_variable_name }] = value;
         return value;
     }
+
+    [[nodiscard]] i64 evaluate_read_only(const SymbolTable& symbol_table) const override {
+        using namespace std::string_literals;
+        static_cast<void>(m_value->evaluate_read_only(symbol_table));
+        throw EvaluationError{ "assignment to \""s + std::string{ m_variable_name } + "\" in read-only evaluation" };
+    }
 };
 
 struct Variable final : public Expression {
@@ -188,14 +310,26 @@ private:
 public:
     explicit Variable(std::string_view variable_name) : m_variable_name{ variable_name } { }
 
+    [[nodiscard]] std::string_view variable_name() const {
+        return m_variable_name;
+    }
+
+    void accept(ExpressionVisitor& visitor) const override {
+        visitor.visit(*this);
+    }
+
     [[nodiscard]] std::string to_string() const override {
         return std::string{ m_variable_name };
     }
 
     [[nodiscard]] i64 evaluate(SymbolTable& symbol_table) const override {
+        return evaluate_read_only(symbol_table);
+    }
+
+    [[nodiscard]] i64 evaluate_read_only(const SymbolTable& symbol_table) const override {
         using namespace std::string_literals;
 
-        const auto find_iterator = symbol_table.find(std::string{ m_variable_name });
+        const auto find_iterator = symbol_table.find(m_variable_name);
         const auto found = (find_iterator != symbol_table.cend());
         if (not found) {
             throw EvaluationError{ "use of undefined variable \""s + std::string{ m_variable_name } + "\"" };
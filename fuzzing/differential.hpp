@@ -0,0 +1,47 @@
+#pragma once
+
+#include "engines.hpp"
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+struct EngineRun {
+    std::vector<Outcome> outcomes; // one outcome per input line
+    SymbolTable symbol_table;      // state of the symbol table after the last line
+};
+
+template<typename Lines>
+[[nodiscard]] EngineRun run_engine(const Engine& engine, const Lines& lines) {
+    auto result = EngineRun{};
+    for (const auto& line : lines) {
+        result.outcomes.push_back(engine.evaluate(line, result.symbol_table));
+    }
+    return result;
+}
+
+/* Runs all engines on the given lines and compares them to the first (reference) engine. Returns a
+ * human-readable description of the first difference or an empty optional if all engines agree. */
+template<typename Lines>
+[[nodiscard]] std::optional<std::string> find_mismatch(std::span<const Engine> engines, const Lines& lines) {
+    if (engines.size() < 2) {
+        return {};
+    }
+    const auto expected = run_engine(engines.front(), lines);
+    for (const auto& engine : engines.subspan(1)) {
+        const auto actual = run_engine(engine, lines);
+        for (usize i = 0; i < expected.outcomes.size(); ++i) {
+            if (expected.outcomes.at(i) != actual.outcomes.at(i)) {
+                return concatenate(
+                        "line ", std::to_string(i + 1), ": ", engines.front().name, " reported \"",
+                        expected.outcomes.at(i).to_string(), "\", but ", engine.name, " reported \"",
+                        actual.outcomes.at(i).to_string(), "\""
+                );
+            }
+        }
+        if (expected.symbol_table != actual.symbol_table) {
+            return concatenate("symbol tables of ", engines.front().name, " and ", engine.name, " differ");
+        }
+    }
+    return {};
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "../expressions.hpp"
+#include "../parser.hpp"
+#include "../precompiled.hpp"
+#include "../scanner.hpp"
+#include "../streaming.hpp"
+#include "../utils.hpp"
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+enum class OutcomeKind {
+    Value,
+    ScannerError,
+    ParserError,
+    EvaluationError,
+};
+
+/* The observable result of evaluating a single line of input. Two engines are considered equivalent
+ * if they produce the same outcomes (and leave the symbol table in the same state) for every input. */
+struct Outcome {
+    OutcomeKind kind{ OutcomeKind::Value };
+    i64 value{ 0 };
+    usize position{ 0 }; // byte offset of the offending token (only for parser errors)
+    std::string message{};
+
+    [[nodiscard]] bool operator==(const Outcome&) const = default;
+
+    [[nodiscard]] std::string to_string() const {
+        switch (kind) {
+            case OutcomeKind::Value:
+                return concatenate("value ", std::to_string(value));
+            case OutcomeKind::ScannerError:
+                return "scanner error";
+            case OutcomeKind::ParserError:
+                return concatenate("parser error at ", std::to_string(position), ": ", message);
+            case OutcomeKind::EvaluationError:
+                return concatenate("evaluation error: ", message);
+            default:
+                assert(false and "unreachable");
+                return "";
+        }
+    }
+};
+
+struct Engine {
+    std::string name;
+    std::function<Outcome(std::string_view input, SymbolTable& symbol_table)> evaluate;
+};
+
+// suppresses the diagnostics that the scanner prints to std::cerr while the guard is alive
+class SilencedErrorStream final {
+private:
+    std::ostringstream m_sink;
+    std::streambuf* m_original_buffer;
+
+public:
+    SilencedErrorStream() : m_original_buffer{ std::cerr.rdbuf(m_sink.rdbuf()) } { }
+    SilencedErrorStream(const SilencedErrorStream&) = delete;
+    SilencedErrorStream& operator=(const SilencedErrorStream&) = delete;
+
+    ~SilencedErrorStream() {
+        std::cerr.rdbuf(m_original_buffer);
+    }
+};
+
+// runs tokenize() + Parser::parse() and hands the syntax tree to the given function for evaluation
+template<typename Evaluate>
+[[nodiscard]] Outcome parse_and_evaluate(const std::string_view input, Evaluate&& evaluate) {
+    auto tokens = tokenize(input);
+    if (not tokens.has_value()) {
+        return Outcome{ .kind = OutcomeKind::ScannerError };
+    }
+    auto parser = Parser{ input, std::move(*tokens) };
+    try {
+        const auto abstract_syntax_tree = parser.parse();
+        return Outcome{ .value = std::forward<Evaluate>(evaluate)(*abstract_syntax_tree) };
+    } catch (const ParserError& exception) {
+        const auto lexeme = exception.token->lexeme;
+        const auto position = (lexeme.empty() ? input.length() : lexeme_offsets(lexeme, input).first);
+        return Outcome{ .kind = OutcomeKind::ParserError,
+                        .position = position,
+                        .message = std::string{ exception.error_message } };
+    } catch (const EvaluationError& exception) {
+        return Outcome{ .kind = OutcomeKind::EvaluationError, .message = exception.error_message };
+    }
+}
+
+[[nodiscard]] inline Outcome evaluate_streaming(const std::string_view input, SymbolTable& symbol_table) {
+    auto stream = std::istringstream{ std::string{ input } };
+    try {
+        return Outcome{ .value = evaluate_stream(stream, symbol_table) };
+    } catch (const StreamingError& exception) {
+        switch (exception.type) {
+            case StreamingErrorType::Scanner:
+                return Outcome{ .kind = OutcomeKind::ScannerError };
+            case StreamingErrorType::Parser:
+                return Outcome{ .kind = OutcomeKind::ParserError,
+                                .position = exception.offset,
+                                .message = exception.error_message };
+            case StreamingErrorType::Evaluation:
+                return Outcome{ .kind = OutcomeKind::EvaluationError, .message = exception.error_message };
+        }
+        assert(false and "unreachable");
+        return Outcome{};
+    }
+}
+
+// the tokenize() + Parser::parse() + Expression::evaluate() pipeline that is also used by the REPL
+[[nodiscard]] inline Outcome evaluate_reference(const std::string_view input, SymbolTable& symbol_table) {
+    return parse_and_evaluate(input, [&](const Expression& expression) { return expression.evaluate(symbol_table); });
+}
+
+// round trip through the precompiled file format before evaluating
+[[nodiscard]] inline Outcome evaluate_precompiled(const std::string_view input, SymbolTable& symbol_table) {
+    return parse_and_evaluate(input, [&](const Expression& expression) {
+        auto writer = PrecompiledWriter{};
+        writer.add(expression);
+        const auto bytes = writer.serialize();
+        return PrecompiledView{ bytes }.formula(0).evaluate(symbol_table);
+    });
+}
+
+/* All engines that take part in differential testing. The first entry is the reference implementation
+ * all other engines get compared against. Add alternative implementations here. */
+[[nodiscard]] inline std::vector<Engine> engines() {
+    return {
+        Engine{ "reference", evaluate_reference },
+        Engine{ "streaming", evaluate_streaming },
+        Engine{ "precompiled", evaluate_precompiled },
+    };
+}
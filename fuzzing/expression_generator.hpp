@@ -0,0 +1,283 @@
+#pragma once
+
+#include "../types.hpp"
+#include "../utils.hpp"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct GeneratorOptions {
+    usize max_depth{ 4 };      // maximum nesting depth of sub-expressions
+    usize max_width{ 4 };      // maximum number of operands in a single sum or product chain
+    usize variable_count{ 3 }; // number of variables that get defined before the expression is evaluated
+    double error_rate{ 0.0 };  // probability that a generated case contains an (intentional) error
+    u32 max_literal{ 100 };
+};
+
+// A single test case: every line is evaluated in order against the same (initially empty) symbol table.
+// The first lines define the variables, the last line contains the actual expression.
+struct GeneratedCase {
+    std::vector<std::string> lines;
+};
+
+enum class InjectedError {
+    None,
+    UndefinedVariable,
+    DivisionByZero,
+    Syntax,
+    Scanner,
+};
+
+class ExpressionGenerator final {
+private:
+    /* upper bound for the absolute value of every generated (error-free) sub-expression. Keeping all
+     * intermediate values below this bound guarantees that no evaluation can overflow an i64 */
+    static constexpr u64 value_limit = u64{ 1 } << 40;
+
+    GeneratorOptions m_options;
+    std::mt19937_64 m_random;
+    std::vector<u64> m_variable_bounds;
+    InjectedError m_pending_error{ InjectedError::None };
+
+    struct Generated {
+        std::string text;
+        u64 bound;             // upper bound for the absolute value
+        bool non_zero{ false }; // true if the value is guaranteed to be non-zero
+    };
+
+public:
+    ExpressionGenerator(GeneratorOptions options, const u64 seed) : m_options{ options }, m_random{ seed } { }
+
+    [[nodiscard]] GeneratedCase generate() {
+        auto result = GeneratedCase{};
+        m_variable_bounds.clear();
+        m_pending_error = InjectedError::None;
+        if (chance(m_options.error_rate)) {
+            const auto first = static_cast<usize>(InjectedError::UndefinedVariable);
+            const auto last = static_cast<usize>(InjectedError::Scanner);
+            m_pending_error = static_cast<InjectedError>(uniform(first, last));
+        }
+
+        for (usize i = 0; i < m_options.variable_count; ++i) {
+            const auto value = literal_value();
+            const auto equals = spaced("=");
+            result.lines.push_back(concatenate(variable_name(i), equals, std::to_string(value)));
+            m_variable_bounds.push_back(value);
+        }
+
+        auto expression = generate_expression(m_options.max_depth).text;
+        switch (m_pending_error) {
+            case InjectedError::UndefinedVariable: {
+                const auto plus = spaced("+");
+                expression += concatenate(plus, undefined_variable_name());
+                break;
+            }
+            case InjectedError::DivisionByZero:
+                expression += concatenate(spaced("/"), "0");
+                break;
+            case InjectedError::Syntax:
+                inject_syntax_error(expression);
+                break;
+            case InjectedError::Scanner:
+                inject_scanner_error(expression);
+                break;
+            case InjectedError::None:
+                break;
+        }
+        result.lines.push_back(std::move(expression));
+        return result;
+    }
+
+private:
+    [[nodiscard]] Generated generate_expression(const usize depth) {
+        if (depth == 0 or chance(0.2)) {
+            return leaf();
+        }
+        switch (uniform(0, 4)) {
+            case 0:
+                return chain(depth, false);
+            case 1:
+                return chain(depth, true);
+            case 2: {
+                auto operand = generate_expression(depth - 1);
+                const auto operator_text = (chance(0.5) ? "-" : "+");
+                const auto gap = spaces();
+                const auto operand_text = parenthesized(operand.text);
+                return { concatenate(operator_text, gap, operand_text), operand.bound, operand.non_zero };
+            }
+            case 3: {
+                if (m_variable_bounds.empty()) {
+                    return parenthesized(generate_expression(depth - 1));
+                }
+                // nested assignment, e.g. "(x1 = 3 * 4)"
+                const auto index = uniform(0, m_variable_bounds.size() - 1);
+                auto value = generate_expression(depth - 1);
+                m_variable_bounds.at(index) = std::max(m_variable_bounds.at(index), value.bound);
+                const auto equals = spaced("=");
+                return { concatenate("(", variable_name(index), equals, value.text, ")"), value.bound, value.non_zero };
+            }
+            default:
+                return parenthesized(generate_expression(depth - 1));
+        }
+    }
+
+    [[nodiscard]] Generated chain(const usize depth, const bool multiplicative) {
+        auto accumulator = generate_expression(depth - 1);
+        const auto width = uniform(2, std::max(m_options.max_width, usize{ 2 }));
+        for (usize i = 1; i < width; ++i) {
+            auto operand = generate_expression(depth - 1);
+            if (not multiplicative) {
+                const auto operator_text = spaced(chance(0.5) ? "+" : "-");
+                const auto operand_text = parenthesized(operand.text);
+                accumulator.text += concatenate(operator_text, operand_text);
+                accumulator.bound = saturating_add(accumulator.bound, operand.bound);
+                accumulator.non_zero = false;
+                continue;
+            }
+            const auto product_bound = saturating_multiply(accumulator.bound, operand.bound);
+            if (product_bound < value_limit and chance(0.7)) {
+                const auto operator_text = spaced("*");
+                const auto operand_text = parenthesized(operand.text);
+                accumulator.text += concatenate(operator_text, operand_text);
+                accumulator.bound = product_bound;
+                accumulator.non_zero = (accumulator.non_zero and operand.non_zero);
+                continue;
+            }
+            // dividing never increases the absolute value, but the divisor must not be zero in error-free cases
+            if (not operand.non_zero) {
+                operand = non_zero_literal();
+            }
+            const auto operator_text = spaced("/");
+            const auto operand_text = parenthesized(operand.text);
+            accumulator.text += concatenate(operator_text, operand_text);
+            accumulator.non_zero = false;
+        }
+        if (accumulator.bound >= value_limit) {
+            // the sum got too big => start over with something smaller
+            return leaf();
+        }
+        return accumulator;
+    }
+
+    [[nodiscard]] Generated leaf() {
+        if (m_pending_error == InjectedError::UndefinedVariable and chance(0.1)) {
+            m_pending_error = InjectedError::None;
+            return { undefined_variable_name(), 0 };
+        }
+        if (m_pending_error == InjectedError::DivisionByZero and chance(0.1)) {
+            m_pending_error = InjectedError::None;
+            const auto dividend = literal_value();
+            const auto slash = spaced("/");
+            return { concatenate("(", std::to_string(dividend), slash, "0)"), 0 };
+        }
+        if (not m_variable_bounds.empty() and chance(0.3)) {
+            const auto index = uniform(0, m_variable_bounds.size() - 1);
+            return { variable_name(index), m_variable_bounds.at(index) };
+        }
+        const auto value = literal_value();
+        return { std::to_string(value), value, value != 0 };
+    }
+
+    [[nodiscard]] Generated non_zero_literal() {
+        const auto value = static_cast<u32>(uniform(1, std::max(m_options.max_literal, u32{ 1 })));
+        return { std::to_string(value), value, true };
+    }
+
+    void inject_syntax_error(std::string& expression) {
+        static constexpr auto syntax_characters = std::string_view{ "()+-*/=" };
+        const auto position = uniform(0, expression.length());
+        switch (uniform(0, 2)) {
+            case 0:
+                if (not expression.empty()) {
+                    expression.erase(std::min(position, expression.length() - 1), 1);
+                    break;
+                }
+                [[fallthrough]];
+            case 1:
+                expression.insert(position, 1, syntax_characters.at(uniform(0, syntax_characters.length() - 1)));
+                break;
+            default:
+                expression.resize(position);
+                break;
+        }
+    }
+
+    void inject_scanner_error(std::string& expression) {
+        static constexpr auto invalid_characters = std::string_view{ "$#%!?.,;" };
+        const auto position = uniform(0, expression.length());
+        if (chance(0.5)) {
+            expression.insert(position, 1, invalid_characters.at(uniform(0, invalid_characters.length() - 1)));
+        } else {
+            // the literal exceeds the range of a u32
+            expression.insert(position, " 4294967296 ");
+        }
+    }
+
+    [[nodiscard]] Generated parenthesized(Generated generated) {
+        generated.text = parenthesized(generated.text);
+        return generated;
+    }
+
+    /* the helpers that draw from the random engine are always called into locals (in a fixed order) before
+     * their results get concatenated: the evaluation order of function arguments is unspecified, so the same
+     * seed would produce different cases with different compilers otherwise */
+    [[nodiscard]] std::string parenthesized(const std::string& text) {
+        const auto before = spaces();
+        const auto after = spaces();
+        return concatenate("(", before, text, after, ")");
+    }
+
+    // the given operator surrounded by a random amount of spaces
+    [[nodiscard]] std::string spaced(const std::string_view operator_text) {
+        const auto before = spaces();
+        const auto after = spaces();
+        return concatenate(before, operator_text, after);
+    }
+
+    [[nodiscard]] static std::string variable_name(const usize index) {
+        return concatenate("x", std::to_string(index));
+    }
+
+    [[nodiscard]] std::string undefined_variable_name() {
+        return concatenate("undefined", std::to_string(uniform(0, 9)));
+    }
+
+    [[nodiscard]] std::string spaces() {
+        return std::string(chance(0.5) ? uniform(0, 2) : 0, ' ');
+    }
+
+    [[nodiscard]] u32 literal_value() {
+        return static_cast<u32>(uniform(0, m_options.max_literal));
+    }
+
+    /* the output of std::mt19937_64 is fully specified, the standard distributions are not (they differ between
+     * libstdc++ and libc++), so the raw numbers are mapped by hand. The modulo bias is irrelevant here */
+    [[nodiscard]] usize uniform(const usize min, const usize max) {
+        const auto range = u64{ max - min };
+        if (range == std::numeric_limits<u64>::max()) {
+            return static_cast<usize>(m_random());
+        }
+        return min + static_cast<usize>(m_random() % (range + 1));
+    }
+
+    [[nodiscard]] bool chance(const double probability) {
+        // 53 random bits => uniformly distributed double in [0, 1)
+        const auto sample = static_cast<double>(m_random() >> 11) * 0x1.0p-53;
+        return sample < probability;
+    }
+
+    [[nodiscard]] static u64 saturating_add(const u64 lhs, const u64 rhs) {
+        return (lhs > std::numeric_limits<u64>::max() - rhs ? std::numeric_limits<u64>::max() : lhs + rhs);
+    }
+
+    [[nodiscard]] static u64 saturating_multiply(const u64 lhs, const u64 rhs) {
+        if (lhs != 0 and rhs > std::numeric_limits<u64>::max() / lhs) {
+            return std::numeric_limits<u64>::max();
+        }
+        return lhs * rhs;
+    }
+};
@@ -0,0 +1,25 @@
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size);
+
+/* Minimal replacement for the libFuzzer main function for compilers that do not ship libFuzzer:
+ * replays every file that is passed on the command line (e.g. a corpus or a crash reproducer). */
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        auto file = std::ifstream{ argv[i], std::ios::binary };
+        if (not file) {
+            std::cerr << "unable to open file \"" << argv[i] << "\"\n";
+            return EXIT_FAILURE;
+        }
+        const auto contents = std::string{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+        std::cout << "running " << argv[i] << "\n";
+        static_cast<void>(
+                LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(contents.data()), contents.size())
+        );
+    }
+}
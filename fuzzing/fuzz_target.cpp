@@ -0,0 +1,37 @@
+#include "differential.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+/* libFuzzer entry point: the input is split into lines which are evaluated in order against one symbol
+ * table by every engine. Any disagreement between the engines is reported as a crash. */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* const data, const std::size_t size) {
+    // very deep nesting only exhausts the stack of the recursive descent parser
+    static constexpr usize max_input_length = 4096;
+    if (size > max_input_length) {
+        return -1;
+    }
+
+    const auto input = std::string_view{ reinterpret_cast<const char*>(data), size };
+    auto lines = std::vector<std::string_view>{};
+    usize line_start = 0;
+    while (line_start <= input.length()) {
+        const auto line_end = std::min(input.find('\n', line_start), input.length());
+        lines.push_back(input.substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
+    }
+
+    static const auto all_engines = engines();
+    const auto mismatch = [&] {
+        const auto silenced = SilencedErrorStream{};
+        return find_mismatch(all_engines, lines);
+    }();
+    if (mismatch.has_value()) {
+        std::cerr << "engine mismatch: " << *mismatch << "\n";
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,314 @@
+#include "differential.hpp"
+#include "expression_generator.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Randomized stress test: generates corpora of random expressions, checks that all engines agree on every
+ * generated case and measures the throughput of each engine per corpus.
+ *
+ * Speed regressions are caught in three ways, all of them optional:
+ *   --min-throughput    absolute floor in MiB/s for every engine
+ *   --max-slowdown      every engine must reach at least 1/F of the throughput of the reference engine (the
+ *                       first one) on the same corpus in the same run, this moves with the machine
+ *   --baseline          per-machine throughput of every engine and corpus. If the file does not exist (or
+ *                       --update-baseline is given), the measured values are written to it; otherwise every
+ *                       value must not fall more than --max-regression percent below the stored one
+ *
+ * usage: kalkumulator_stress [--seed N] [--cases N] [--repetitions N] [--corpus NAME]
+ *                            [--depth N] [--width N] [--variables N] [--error-rate P] [--max-literal N]
+ *                            [--min-throughput MIB_PER_SECOND] [--max-slowdown F]
+ *                            [--baseline FILE] [--max-regression PERCENT] [--update-baseline] [--emit-corpus]
+ */
+
+struct Corpus {
+    std::string name;
+    GeneratorOptions options;
+};
+
+struct Settings {
+    u64 seed{ 42 };
+    usize cases{ 2000 };
+    usize repetitions{ 3 };
+    std::optional<std::string> corpus_name;
+    std::optional<usize> depth;
+    std::optional<usize> width;
+    std::optional<usize> variables;
+    std::optional<double> error_rate;
+    std::optional<u32> max_literal;
+    double min_throughput{ 0.0 };
+    std::optional<double> max_slowdown;
+    std::optional<std::string> baseline_path;
+    double max_regression{ 25.0 }; // in percent
+    bool update_baseline{ false };
+    bool emit_corpus{ false };
+};
+
+// throughput in MiB/s, keyed by "<corpus> <engine>"
+using Throughputs = std::map<std::string, double>;
+
+[[nodiscard]] static std::vector<Corpus> default_corpora() {
+    return {
+        Corpus{ "shallow", GeneratorOptions{ .max_depth = 2, .max_width = 3, .variable_count = 2 } },
+        Corpus{ "deep", GeneratorOptions{ .max_depth = 10, .max_width = 2, .variable_count = 3 } },
+        Corpus{ "wide", GeneratorOptions{ .max_depth = 3, .max_width = 16, .variable_count = 8 } },
+        Corpus{ "errors", GeneratorOptions{ .max_depth = 4, .max_width = 4, .variable_count = 3, .error_rate = 0.5 } },
+    };
+}
+
+[[nodiscard]] static std::optional<Settings> parse_arguments(const int argc, char** const argv) {
+    auto settings = Settings{};
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = std::string_view{ argv[i] };
+        if (argument == "--emit-corpus") {
+            settings.emit_corpus = true;
+            continue;
+        }
+        if (argument == "--update-baseline") {
+            settings.update_baseline = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for argument \"" << argument << "\"\n";
+            return {};
+        }
+        const auto value = std::string{ argv[++i] };
+        try {
+            if (argument == "--seed") {
+                settings.seed = std::stoull(value);
+            } else if (argument == "--cases") {
+                settings.cases = std::stoull(value);
+            } else if (argument == "--repetitions") {
+                settings.repetitions = std::max(std::stoull(value), 1ULL);
+            } else if (argument == "--corpus") {
+                settings.corpus_name = value;
+            } else if (argument == "--depth") {
+                settings.depth = std::stoull(value);
+            } else if (argument == "--width") {
+                settings.width = std::stoull(value);
+            } else if (argument == "--variables") {
+                settings.variables = std::stoull(value);
+            } else if (argument == "--error-rate") {
+                settings.error_rate = std::stod(value);
+            } else if (argument == "--max-literal") {
+                settings.max_literal = static_cast<u32>(std::stoul(value));
+            } else if (argument == "--min-throughput") {
+                settings.min_throughput = std::stod(value);
+            } else if (argument == "--max-slowdown") {
+                settings.max_slowdown = std::stod(value);
+            } else if (argument == "--baseline") {
+                settings.baseline_path = value;
+            } else if (argument == "--max-regression") {
+                settings.max_regression = std::stod(value);
+            } else {
+                std::cerr << "unknown argument \"" << argument << "\"\n";
+                return {};
+            }
+        } catch (const std::logic_error&) {
+            std::cerr << "invalid value \"" << value << "\" for argument \"" << argument << "\"\n";
+            return {};
+        }
+    }
+    return settings;
+}
+
+[[nodiscard]] static std::vector<Corpus> selected_corpora(const Settings& settings) {
+    auto result = std::vector<Corpus>{};
+    for (auto corpus : default_corpora()) {
+        if (settings.corpus_name.has_value() and corpus.name != *settings.corpus_name) {
+            continue;
+        }
+        corpus.options.max_depth = settings.depth.value_or(corpus.options.max_depth);
+        corpus.options.max_width = settings.width.value_or(corpus.options.max_width);
+        corpus.options.variable_count = settings.variables.value_or(corpus.options.variable_count);
+        corpus.options.error_rate = settings.error_rate.value_or(corpus.options.error_rate);
+        corpus.options.max_literal = settings.max_literal.value_or(corpus.options.max_literal);
+        result.push_back(std::move(corpus));
+    }
+    return result;
+}
+
+[[nodiscard]] static std::vector<GeneratedCase> generate_cases(const Corpus& corpus, const Settings& settings) {
+    auto generator = ExpressionGenerator{ corpus.options, settings.seed };
+    auto cases = std::vector<GeneratedCase>{};
+    cases.reserve(settings.cases);
+    for (usize i = 0; i < settings.cases; ++i) {
+        cases.push_back(generator.generate());
+    }
+    return cases;
+}
+
+/* returns the seconds per pass over all cases. Small corpora are processed repeatedly until the measurement
+ * takes long enough to not be dominated by timer resolution and scheduling noise */
+[[nodiscard]] static double measure_seconds(const Engine& engine, const std::vector<GeneratedCase>& cases) {
+    static constexpr auto min_duration = std::chrono::milliseconds{ 100 };
+    const auto start = std::chrono::steady_clock::now();
+    usize passes = 0;
+    do {
+        for (const auto& generated_case : cases) {
+            const auto run = run_engine(engine, generated_case.lines);
+            // make sure the work cannot be optimized away
+            if (run.outcomes.empty()) {
+                std::abort();
+            }
+        }
+        ++passes;
+    } while (std::chrono::steady_clock::now() - start < min_duration);
+    const auto elapsed = std::chrono::duration<double>{ std::chrono::steady_clock::now() - start };
+    return elapsed.count() / static_cast<double>(passes);
+}
+
+[[nodiscard]] static Throughputs read_baseline(const std::string& path) {
+    auto result = Throughputs{};
+    auto file = std::ifstream{ path };
+    auto corpus = std::string{};
+    auto engine = std::string{};
+    auto throughput = 0.0;
+    while (file >> corpus >> engine >> throughput) {
+        result[concatenate(corpus, " ", engine)] = throughput;
+    }
+    return result;
+}
+
+[[nodiscard]] static bool write_baseline(const std::string& path, const Throughputs& throughputs) {
+    auto file = std::ofstream{ path };
+    file << std::fixed << std::setprecision(6);
+    for (const auto& [key, throughput] : throughputs) {
+        file << key << " " << throughput << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+// compares against the stored baseline (or records it) and reports every regression
+[[nodiscard]] static bool check_baseline(const Settings& settings, const Throughputs& throughputs) {
+    const auto& path = *settings.baseline_path;
+    if (settings.update_baseline or not std::filesystem::exists(path)) {
+        if (not write_baseline(path, throughputs)) {
+            std::cout << "unable to write baseline \"" << path << "\"\n";
+            return false;
+        }
+        std::cout << "recorded throughput baseline in \"" << path << "\"\n";
+        return true;
+    }
+
+    auto success = true;
+    const auto baseline = read_baseline(path);
+    for (const auto& [key, throughput] : throughputs) {
+        const auto find_iterator = baseline.find(key);
+        if (find_iterator == baseline.cend()) {
+            continue;
+        }
+        const auto minimum = find_iterator->second * (1.0 - settings.max_regression / 100.0);
+        if (throughput < minimum) {
+            std::cout << "throughput of \"" << key << "\" dropped from " << std::setprecision(3)
+                      << find_iterator->second << " to " << throughput << " MiB/s (more than "
+                      << settings.max_regression << "% below the baseline)\n";
+            success = false;
+        }
+    }
+    return success;
+}
+
+int main(int argc, char** argv) {
+    const auto settings = parse_arguments(argc, argv);
+    if (not settings.has_value()) {
+        return EXIT_FAILURE;
+    }
+    const auto corpora = selected_corpora(*settings);
+    if (corpora.empty()) {
+        std::cerr << "unknown corpus \"" << settings->corpus_name.value_or("") << "\"\n";
+        return EXIT_FAILURE;
+    }
+
+    if (settings->emit_corpus) {
+        // every case starts with fresh variable definitions, so the corpus can be fed into the REPL as is
+        for (const auto& corpus : corpora) {
+            for (const auto& generated_case : generate_cases(corpus, *settings)) {
+                for (const auto& line : generated_case.lines) {
+                    std::cout << line << "\n";
+                }
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    const auto all_engines = engines();
+    auto success = true;
+    auto throughputs = Throughputs{};
+    const auto silenced = SilencedErrorStream{};
+
+    std::cout << std::left << std::setw(10) << "corpus" << std::setw(12) << "engine" << std::right << std::setw(10)
+              << "cases" << std::setw(12) << "MiB" << std::setw(12) << "MiB/s" << std::setw(14) << "cases/s" << "\n";
+    for (const auto& corpus : corpora) {
+        const auto cases = generate_cases(corpus, *settings);
+
+        usize bytes = 0;
+        usize mismatches = 0;
+        for (const auto& generated_case : cases) {
+            for (const auto& line : generated_case.lines) {
+                bytes += line.length();
+            }
+            const auto mismatch = find_mismatch(all_engines, generated_case.lines);
+            if (not mismatch.has_value()) {
+                continue;
+            }
+            success = false;
+            ++mismatches;
+            if (mismatches <= 5) {
+                std::cout << "mismatch in corpus \"" << corpus.name << "\": " << *mismatch << "\n";
+                for (const auto& line : generated_case.lines) {
+                    std::cout << "    " << line << "\n";
+                }
+            }
+        }
+
+        const auto mebibytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+        // the engines take turns, so that a temporarily slow machine affects all of them alike
+        auto best_seconds = std::vector<double>(all_engines.size(), std::numeric_limits<double>::max());
+        for (usize i = 0; i < settings->repetitions; ++i) {
+            for (usize engine_index = 0; engine_index < all_engines.size(); ++engine_index) {
+                const auto seconds = measure_seconds(all_engines.at(engine_index), cases);
+                best_seconds.at(engine_index) = std::min(best_seconds.at(engine_index), seconds);
+            }
+        }
+        const auto reference_throughput = mebibytes / best_seconds.front();
+        for (usize engine_index = 0; engine_index < all_engines.size(); ++engine_index) {
+            const auto& engine = all_engines.at(engine_index);
+            const auto throughput = mebibytes / best_seconds.at(engine_index);
+            throughputs[concatenate(corpus.name, " ", engine.name)] = throughput;
+            std::cout << std::left << std::setw(10) << corpus.name << std::setw(12) << engine.name << std::right
+                      << std::setw(10) << cases.size() << std::setw(12) << std::fixed << std::setprecision(3)
+                      << mebibytes << std::setw(12) << throughput << std::setw(14) << std::setprecision(0)
+                      << (static_cast<double>(cases.size()) / best_seconds.at(engine_index)) << "\n";
+            if (throughput < settings->min_throughput) {
+                std::cout << "throughput of engine \"" << engine.name << "\" on corpus \"" << corpus.name
+                          << "\" is below the minimum of " << std::setprecision(3) << settings->min_throughput
+                          << " MiB/s\n";
+                success = false;
+            }
+            if (settings->max_slowdown.has_value() and throughput * *settings->max_slowdown < reference_throughput) {
+                std::cout << "engine \"" << engine.name << "\" on corpus \"" << corpus.name << "\" is more than "
+                          << std::setprecision(1) << *settings->max_slowdown << " times slower than \""
+                          << all_engines.front().name << "\"\n";
+                success = false;
+            }
+        }
+        if (mismatches > 0) {
+            std::cout << mismatches << " of " << cases.size() << " cases in corpus \"" << corpus.name
+                      << "\" produced different results\n";
+        }
+    }
+    if (settings->baseline_path.has_value() and not check_baseline(*settings, throughputs)) {
+        success = false;
+    }
+    return (success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -1,7 +1,13 @@
 #include "parser.hpp"
+#include "precompiled.hpp"
 #include "scanner.hpp"
+#include "streaming.hpp"
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <string_view>
 
 [[nodiscard]] std::string read_input() {
     auto input = std::string{};
@@ -10,7 +16,125 @@
     return input;
 }
 
-int main() {
+/* evaluates a single (possibly huge) expression from the given file ("-" for stdin) without loading it into
+ * memory as a whole */
+[[nodiscard]] int evaluate_file(const std::string_view path) {
+    auto file = std::ifstream{};
+    if (path != "-") {
+        file.open(std::string{ path }, std::ios::binary);
+        if (not file) {
+            std::cerr << "unable to open file \"" << path << "\"\n";
+            return EXIT_FAILURE;
+        }
+    }
+    auto& input = (path == "-" ? std::cin : file);
+
+    auto symbol_table = SymbolTable{};
+    try {
+        std::cout << evaluate_stream(input, symbol_table) << "\n";
+        return EXIT_SUCCESS;
+    } catch (const StreamingError& exception) {
+        if (exception.type == StreamingErrorType::Evaluation) {
+            std::cerr << "  evaluation error at byte " << exception.offset << ": " << exception.error_message << "\n";
+        } else {
+            std::cerr << "  error at byte " << exception.offset << "\n  reason: " << exception.error_message << "\n";
+        }
+        return EXIT_FAILURE;
+    }
+}
+
+/* compiles a file containing one formula per line (empty lines are ignored) into a precompiled file that
+ * can be loaded without parsing */
+[[nodiscard]] int precompile(const std::string& input_path, const std::string& output_path) {
+    auto input = std::ifstream{ input_path };
+    if (not input) {
+        std::cerr << "unable to open file \"" << input_path << "\"\n";
+        return EXIT_FAILURE;
+    }
+
+    auto writer = PrecompiledWriter{};
+    auto line = std::string{};
+    usize line_number = 0;
+    usize formula_count = 0;
+    while (std::getline(input, line)) {
+        ++line_number;
+        if (line.find_first_not_of(" \t\r\n\f\v") == std::string::npos) {
+            continue;
+        }
+        // the error messages are aligned to the echoed line
+        const auto report_location = [&] { std::cerr << "  in line " << line_number << ":\n> " << line << "\n"; };
+        // tokenize() prints its diagnostic right away, it is held back until the line has been echoed
+        auto scanner_diagnostic = std::ostringstream{};
+        auto* const error_buffer = std::cerr.rdbuf(scanner_diagnostic.rdbuf());
+        auto tokens = tokenize(line);
+        std::cerr.rdbuf(error_buffer);
+        if (not tokens.has_value()) {
+            report_location();
+            std::cerr << scanner_diagnostic.str();
+            return EXIT_FAILURE;
+        }
+        auto parser = Parser{ line, std::move(*tokens) };
+        try {
+            writer.add(*parser.parse());
+            ++formula_count;
+        } catch (const ParserError& exception) {
+            report_location();
+            print_error(exception.input, *(exception.token), exception.error_message);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto bytes = writer.serialize();
+    auto output = std::ofstream{ output_path, std::ios::binary };
+    output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (not output) {
+        std::cerr << "unable to write file \"" << output_path << "\"\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "precompiled " << formula_count << " formulas into \"" << output_path << "\" (" << bytes.size()
+              << " bytes)\n";
+    return EXIT_SUCCESS;
+}
+
+// evaluates all formulas of a precompiled file in order
+[[nodiscard]] int run_precompiled(const std::string& path) {
+    try {
+        const auto file = PrecompiledFile{ path };
+        auto symbol_table = SymbolTable{};
+        for (usize i = 0; i < file.view().formula_count(); ++i) {
+            try {
+                std::cout << file.view().formula(i).evaluate(symbol_table) << "\n";
+            } catch (const EvaluationError& exception) {
+                std::cerr << "  evaluation error: " << exception.error_message << "\n";
+            }
+        }
+        return EXIT_SUCCESS;
+    } catch (const FileMappingError& exception) {
+        std::cerr << exception.error_message << "\n";
+    } catch (const PrecompiledFileError& exception) {
+        std::cerr << "invalid precompiled file \"" << path << "\": " << exception.error_message << "\n";
+    }
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+    const auto mode = (argc > 1 ? std::string_view{ argv[1] } : std::string_view{});
+    if (argc == 3 and mode == "--stream") {
+        return evaluate_file(argv[2]);
+    }
+    if (argc == 4 and mode == "--precompile") {
+        return precompile(argv[2], argv[3]);
+    }
+    if (argc == 3 and mode == "--run-precompiled") {
+        return run_precompiled(argv[2]);
+    }
+    if (argc != 1) {
+        std::cerr << "usage: " << argv[0] << " [--stream <file>]\n"
+                  << "       " << argv[0] << " --precompile <formula file> <output file>\n"
+                  << "       " << argv[0] << " --run-precompiled <precompiled file>\n";
+        return EXIT_FAILURE;
+    }
+
     std::cout << "Kalkumulator 1.0\n"
                  "Enter a mathematical expression you want to be evaluated. Type \"exit\" to quit.\n";
 
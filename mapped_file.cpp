@@ -0,0 +1,85 @@
+#include "mapped_file.hpp"
+#include "utils.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    const auto file = CreateFileA(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw FileMappingError{ concatenate("unable to open file \"", path, "\"") };
+    }
+    auto size = LARGE_INTEGER{};
+    if (not GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw FileMappingError{ concatenate("unable to determine the size of file \"", path, "\"") };
+    }
+    m_size = static_cast<usize>(size.QuadPart);
+    if (m_size == 0) {
+        CloseHandle(file);
+        return;
+    }
+    const auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw FileMappingError{ concatenate("unable to map file \"", path, "\"") };
+    }
+    m_data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (m_data == nullptr) {
+        throw FileMappingError{ concatenate("unable to map file \"", path, "\"") };
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    const auto file = open(path.c_str(), O_RDONLY);
+    if (file == -1) {
+        throw FileMappingError{ concatenate("unable to open file \"", path, "\"") };
+    }
+    struct stat status {};
+    if (fstat(file, &status) != 0) {
+        close(file);
+        throw FileMappingError{ concatenate("unable to determine the size of file \"", path, "\"") };
+    }
+    m_size = static_cast<usize>(status.st_size);
+    if (m_size == 0) {
+        // mapping an empty file is not possible
+        close(file);
+        return;
+    }
+    const auto address = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping stays valid after the file descriptor has been closed
+    close(file);
+    if (address == MAP_FAILED) {
+        throw FileMappingError{ concatenate("unable to map file \"", path, "\"") };
+    }
+    m_data = static_cast<const std::byte*>(address);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data != nullptr) {
+        munmap(const_cast<std::byte*>(m_data), m_size);
+    }
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+struct FileMappingError final : public std::exception {
+    std::string error_message;
+
+    explicit FileMappingError(std::string error_message) : error_message{ std::move(error_message) } { }
+};
+
+// read-only memory mapping of a whole file
+class MappedFile final {
+private:
+    const std::byte* m_data{ nullptr };
+    usize m_size{ 0 };
+
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] std::span<const std::byte> bytes() const {
+        return { m_data, m_size };
+    }
+};
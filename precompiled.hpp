@@ -0,0 +1,506 @@
+#pragma once
+
+#include "expressions.hpp"
+#include "mapped_file.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* Binary format for precompiled formulas. Every formula is stored as byte code for a simple stack machine,
+ * all variable names are interned into one name table. Files are loaded by mapping them into memory and can
+ * be evaluated in place without building a syntax tree.
+ *
+ * layout (all values are stored in the byte order of the machine that wrote the file):
+ *     PrecompiledHeader
+ *     FormulaEntry[formula_count]
+ *     NameEntry[name_count]
+ *     byte[code_size]                 (the byte code of all formulas)
+ *     char[string_data_size]          (the variable names, not null-terminated)
+ *
+ * Every instruction consists of an Opcode byte, optionally followed by an operand that is encoded as
+ * unsigned LEB128 (7 bits per byte, least significant group first). */
+
+struct PrecompiledFileError final : public std::exception {
+    std::string error_message;
+
+    explicit PrecompiledFileError(std::string error_message) : error_message{ std::move(error_message) } { }
+};
+
+struct PrecompiledHeader {
+    static constexpr auto expected_magic = std::array{ 'K', 'A', 'L', 'K' };
+    static constexpr u32 current_version = 1;
+    static constexpr u32 expected_byte_order = 0x01020304;
+
+    std::array<char, 4> magic{ expected_magic };
+    u32 version{ current_version };
+    u32 byte_order{ expected_byte_order };
+    u32 formula_count{ 0 };
+    u32 name_count{ 0 };
+    u32 code_size{ 0 };
+    u32 string_data_size{ 0 };
+    u32 reserved{ 0 };
+};
+
+// the byte code of a formula ends where the byte code of the next formula (or the whole byte code) ends
+struct FormulaEntry {
+    u32 code_offset; // relative to the start of the byte code
+};
+
+struct NameEntry {
+    u32 offset; // into the string data
+    u32 length;
+};
+
+enum class Opcode : u8 {
+    PushInteger,  // operand: the value
+    PushVariable, // operand: index into the name table
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Negate,
+    Assign, // operand: index into the name table, the assigned value stays on the stack
+};
+
+static_assert(sizeof(PrecompiledHeader) == 32);
+static_assert(sizeof(FormulaEntry) == 4);
+static_assert(sizeof(NameEntry) == 8);
+
+// collects formulas and turns them into the binary format
+class PrecompiledWriter final {
+private:
+    std::vector<FormulaEntry> m_formulas;
+    std::vector<std::byte> m_code;
+    std::vector<std::string> m_names;
+    std::unordered_map<std::string, u32> m_name_indices;
+
+    class Compiler final : public ExpressionVisitor {
+    private:
+        PrecompiledWriter& m_writer;
+
+    public:
+        explicit Compiler(PrecompiledWriter& writer) : m_writer{ writer } { }
+
+        void visit(const IntegerValue& expression) override {
+            emit(Opcode::PushInteger, expression.value());
+        }
+
+        void visit(const BinaryOperator& expression) override {
+            expression.lhs().accept(*this);
+            expression.rhs().accept(*this);
+            switch (expression.operator_type()) {
+                case BinaryOperatorType::Add:
+                    emit(Opcode::Add);
+                    break;
+                case BinaryOperatorType::Subtract:
+                    emit(Opcode::Subtract);
+                    break;
+                case BinaryOperatorType::Multiply:
+                    emit(Opcode::Multiply);
+                    break;
+                case BinaryOperatorType::Divide:
+                    emit(Opcode::Divide);
+                    break;
+                default:
+                    assert(false and "unreachable");
+                    break;
+            }
+        }
+
+        void visit(const UnaryOperator& expression) override {
+            expression.sub_expression().accept(*this);
+            if (expression.operator_type() == UnaryOperatorType::Minus) {
+                emit(Opcode::Negate);
+            }
+        }
+
+        void visit(const Assignment& expression) override {
+            expression.value().accept(*this);
+            emit(Opcode::Assign, m_writer.intern(expression.variable_name()));
+        }
+
+        void visit(const Variable& expression) override {
+            emit(Opcode::PushVariable, m_writer.intern(expression.variable_name()));
+        }
+
+    private:
+        void emit(const Opcode opcode) {
+            m_writer.m_code.push_back(static_cast<std::byte>(opcode));
+        }
+
+        void emit(const Opcode opcode, u32 operand) {
+            emit(opcode);
+            while (operand >= 0x80) {
+                m_writer.m_code.push_back(static_cast<std::byte>((operand & 0x7F) | 0x80));
+                operand >>= 7;
+            }
+            m_writer.m_code.push_back(static_cast<std::byte>(operand));
+        }
+    };
+
+public:
+    void add(const Expression& expression) {
+        m_formulas.push_back(FormulaEntry{ .code_offset = checked_u32(m_code.size(), "bytes of byte code") });
+        auto compiler = Compiler{ *this };
+        expression.accept(compiler);
+    }
+
+    [[nodiscard]] std::vector<std::byte> serialize() const {
+        auto name_entries = std::vector<NameEntry>{};
+        auto string_data = std::string{};
+        for (const auto& name : m_names) {
+            name_entries.push_back(NameEntry{ .offset = checked_u32(string_data.length(), "bytes of variable names"),
+                                              .length = checked_u32(name.length(), "bytes in a variable name") });
+            string_data += name;
+        }
+        const auto string_data_size = checked_u32(string_data.length(), "bytes of variable names");
+        const auto header = PrecompiledHeader{ .formula_count = checked_u32(m_formulas.size(), "formulas"),
+                                               .name_count = checked_u32(m_names.size(), "variable names"),
+                                               .code_size = checked_u32(m_code.size(), "bytes of byte code"),
+                                               .string_data_size = string_data_size };
+
+        auto result = std::vector<std::byte>{};
+        append(result, std::span{ &header, 1 });
+        append(result, std::span{ m_formulas });
+        append(result, std::span{ name_entries });
+        append(result, std::span{ m_code });
+        append(result, std::span{ string_data });
+        return result;
+    }
+
+private:
+    [[nodiscard]] u32 intern(const std::string_view name) {
+        const auto index = checked_u32(m_names.size(), "variable names");
+        const auto [iterator, inserted] = m_name_indices.try_emplace(std::string{ name }, index);
+        if (inserted) {
+            m_names.emplace_back(name);
+        }
+        return iterator->second;
+    }
+
+    template<typename T>
+    static void append(std::vector<std::byte>& bytes, const std::span<T> values) {
+        // resize() + memcpy() instead of insert(): GCC 12 reports a bogus -Wstringop-overflow for the latter
+        const auto source = std::as_bytes(values);
+        const auto offset = bytes.size();
+        bytes.resize(offset + source.size());
+        if (not source.empty()) {
+            std::memcpy(bytes.data() + offset, source.data(), source.size());
+        }
+    }
+
+    // what: the counted entity for the error message, e.g. "formulas"
+    [[nodiscard]] static u32 checked_u32(const usize value, const std::string_view what) {
+        if (value > std::numeric_limits<u32>::max()) {
+            throw PrecompiledFileError{ concatenate("too many ", what, " for a single precompiled file") };
+        }
+        return static_cast<u32>(value);
+    }
+};
+
+// non-owning, validated view of precompiled formulas (e.g. inside of a MappedFile)
+class PrecompiledView final {
+private:
+    std::span<const std::byte> m_bytes;
+    PrecompiledHeader m_header;
+    usize m_formulas_offset{ 0 };
+    usize m_names_offset{ 0 };
+    usize m_code_offset{ 0 };
+    usize m_string_data_offset{ 0 };
+    usize m_max_stack_depth{ 0 }; // over all formulas, determined during validation
+
+public:
+    class Formula final {
+    private:
+        const PrecompiledView* m_view;
+        usize m_begin; // absolute byte offsets of the byte code
+        usize m_end;
+
+    public:
+        Formula(const PrecompiledView& view, const usize begin, const usize end)
+            : m_view{ &view },
+              m_begin{ begin },
+              m_end{ end } { }
+
+        [[nodiscard]] i64 evaluate(SymbolTable& symbol_table) const {
+            return evaluate_impl(symbol_table);
+        }
+
+        // assignments are rejected after their value has been evaluated (see Expression::evaluate_read_only)
+        [[nodiscard]] i64 evaluate_read_only(const SymbolTable& symbol_table) const {
+            return evaluate_impl(symbol_table);
+        }
+
+    private:
+        template<typename Table>
+        [[nodiscard]] i64 evaluate_impl(Table& symbol_table) const {
+            using namespace std::string_literals;
+
+            /* reused by all evaluations on this thread (evaluations never nest), so that evaluating does not
+             * allocate once the buffer is large enough for the deepest formula */
+            thread_local auto stack_buffer = std::vector<i64>{};
+            if (stack_buffer.size() < m_view->m_max_stack_depth) {
+                stack_buffer.resize(m_view->m_max_stack_depth);
+            }
+            auto* const stack = stack_buffer.data();
+            usize stack_size = 0; // the validation guarantees that the stack never exceeds m_max_stack_depth
+            const auto push = [&](const i64 value) { stack[stack_size++] = value; };
+            const auto pop = [&] { return stack[--stack_size]; };
+            const auto top = [&]() -> i64& { return stack[stack_size - 1]; };
+
+            for (auto position = m_begin; position < m_end;) {
+                const auto instruction = *m_view->decode(position, m_end);
+                position += instruction.size;
+                switch (instruction.opcode) {
+                    case Opcode::PushInteger:
+                        push(static_cast<i64>(instruction.operand));
+                        break;
+                    case Opcode::PushVariable: {
+                        const auto name = m_view->name(instruction.operand);
+                        const auto find_iterator = symbol_table.find(name);
+                        if (find_iterator == symbol_table.cend()) {
+                            throw EvaluationError{ "use of undefined variable \""s + std::string{ name } + "\"" };
+                        }
+                        push(find_iterator->second);
+                        break;
+                    }
+                    case Opcode::Add: {
+                        const auto right = pop();
+                        top() += right;
+                        break;
+                    }
+                    case Opcode::Subtract: {
+                        const auto right = pop();
+                        top() -= right;
+                        break;
+                    }
+                    case Opcode::Multiply: {
+                        const auto right = pop();
+                        top() *= right;
+                        break;
+                    }
+                    case Opcode::Divide: {
+                        const auto right = pop();
+                        if (right == 0) {
+                            throw EvaluationError{ "divide by zero error" };
+                        }
+                        top() /= right;
+                        break;
+                    }
+                    case Opcode::Negate:
+                        top() = -top();
+                        break;
+                    case Opcode::Assign: {
+                        const auto name = m_view->name(instruction.operand);
+                        if constexpr (std::is_const_v<Table>) {
+                            throw EvaluationError{ "assignment to \""s + std::string{ name }
+                                                   + "\" in read-only evaluation" };
+                        } else if (const auto find_iterator = symbol_table.find(name);
+                                   find_iterator != symbol_table.end()) {
+                            find_iterator->second = top();
+                        } else {
+                            symbol_table.emplace(name, top());
+                        }
+                        break;
+                    }
+                    default:
+                        assert(false and "unreachable");
+                        break;
+                }
+            }
+            return top();
+        }
+    };
+
+    explicit PrecompiledView(const std::span<const std::byte> bytes) : m_bytes{ bytes }, m_header{} {
+        if (m_bytes.size() < sizeof(PrecompiledHeader)) {
+            throw PrecompiledFileError{ "file is too small to be a precompiled file" };
+        }
+        m_header = read<PrecompiledHeader>(0);
+        if (m_header.magic != PrecompiledHeader::expected_magic) {
+            throw PrecompiledFileError{ "file is not a precompiled file" };
+        }
+        if (m_header.byte_order != PrecompiledHeader::expected_byte_order) {
+            throw PrecompiledFileError{ "precompiled file was written on a machine with a different byte order" };
+        }
+        if (m_header.version != PrecompiledHeader::current_version) {
+            throw PrecompiledFileError{ concatenate(
+                    "unsupported version ", std::to_string(m_header.version), " (expected version ",
+                    std::to_string(PrecompiledHeader::current_version), ")"
+            ) };
+        }
+
+        m_formulas_offset = sizeof(PrecompiledHeader);
+        m_names_offset = m_formulas_offset + usize{ m_header.formula_count } * sizeof(FormulaEntry);
+        m_code_offset = m_names_offset + usize{ m_header.name_count } * sizeof(NameEntry);
+        m_string_data_offset = m_code_offset + m_header.code_size;
+        if (m_string_data_offset + m_header.string_data_size != m_bytes.size()) {
+            throw PrecompiledFileError{ "size of precompiled file does not match its header" };
+        }
+        validate();
+    }
+
+    [[nodiscard]] usize formula_count() const {
+        return m_header.formula_count;
+    }
+
+    [[nodiscard]] Formula formula(const usize index) const {
+        assert(index < formula_count());
+        const auto [begin, end] = code_range(index);
+        return Formula{ *this, begin, end };
+    }
+
+private:
+    struct DecodedInstruction {
+        Opcode opcode;
+        u32 operand;
+        usize size; // in bytes
+    };
+
+    // decodes the instruction at the given byte offset, returns an empty optional if the byte code is malformed
+    [[nodiscard]] std::optional<DecodedInstruction> decode(const usize position, const usize end) const {
+        const auto opcode = static_cast<Opcode>(m_bytes[position]);
+        switch (opcode) {
+            case Opcode::PushInteger:
+            case Opcode::PushVariable:
+            case Opcode::Assign:
+                break;
+            default:
+                return DecodedInstruction{ .opcode = opcode, .operand = 0, .size = 1 };
+        }
+        auto operand = u64{ 0 };
+        for (usize i = 1; i <= 5 and position + i < end; ++i) {
+            const auto byte = static_cast<u64>(m_bytes[position + i]);
+            operand |= (byte & 0x7F) << (7 * (i - 1));
+            if ((byte & 0x80) == 0) {
+                if (operand > std::numeric_limits<u32>::max()) {
+                    return {};
+                }
+                return DecodedInstruction{ .opcode = opcode, .operand = static_cast<u32>(operand), .size = i + 1 };
+            }
+        }
+        return {};
+    }
+
+    [[nodiscard]] std::string_view name(const usize index) const {
+        const auto entry = read<NameEntry>(m_names_offset + index * sizeof(NameEntry));
+        return { reinterpret_cast<const char*>(m_bytes.data() + m_string_data_offset + entry.offset), entry.length };
+    }
+
+    // absolute byte offsets of the beginning and the end of the byte code of the given formula
+    [[nodiscard]] std::pair<usize, usize> code_range(const usize index) const {
+        const auto code_offset = [&](const usize formula) {
+            return read<FormulaEntry>(m_formulas_offset + formula * sizeof(FormulaEntry)).code_offset;
+        };
+        const auto begin = code_offset(index);
+        const auto end = (index + 1 < m_header.formula_count ? code_offset(index + 1) : m_header.code_size);
+        return { m_code_offset + begin, m_code_offset + end };
+    }
+
+    // the data is copied since the mapped memory is not guaranteed to contain properly aligned objects
+    template<typename T>
+    [[nodiscard]] T read(const usize offset) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(offset + sizeof(T) <= m_bytes.size());
+        auto result = T{};
+        std::memcpy(&result, m_bytes.data() + offset, sizeof(T));
+        return result;
+    }
+
+    // checks all indices and simulates the stack usage so that evaluating can never access invalid memory
+    void validate() {
+        for (usize i = 0; i < m_header.name_count; ++i) {
+            const auto entry = read<NameEntry>(m_names_offset + i * sizeof(NameEntry));
+            if (usize{ entry.offset } + entry.length > m_header.string_data_size) {
+                throw PrecompiledFileError{ "invalid entry in the name table of precompiled file" };
+            }
+        }
+
+        auto previous_offset = u32{ 0 };
+        for (usize i = 0; i < m_header.formula_count; ++i) {
+            const auto entry = read<FormulaEntry>(m_formulas_offset + i * sizeof(FormulaEntry));
+            if (entry.code_offset < previous_offset or entry.code_offset > m_header.code_size) {
+                throw PrecompiledFileError{ "invalid formula entry in precompiled file" };
+            }
+            previous_offset = entry.code_offset;
+        }
+
+        for (usize i = 0; i < m_header.formula_count; ++i) {
+            usize stack_depth = 0;
+            const auto [begin, end] = code_range(i);
+            for (auto position = begin; position < end;) {
+                const auto decoded = decode(position, end);
+                if (not decoded.has_value()) {
+                    throw PrecompiledFileError{ "malformed instruction in precompiled formula" };
+                }
+                const auto current = *decoded;
+                position += current.size;
+                switch (current.opcode) {
+                    case Opcode::PushVariable:
+                        check_name_index(current.operand);
+                        [[fallthrough]];
+                    case Opcode::PushInteger:
+                        ++stack_depth;
+                        m_max_stack_depth = std::max(m_max_stack_depth, stack_depth);
+                        break;
+                    case Opcode::Add:
+                    case Opcode::Subtract:
+                    case Opcode::Multiply:
+                    case Opcode::Divide:
+                        if (stack_depth < 2) {
+                            throw PrecompiledFileError{ "stack underflow in precompiled formula" };
+                        }
+                        --stack_depth;
+                        break;
+                    case Opcode::Assign:
+                        check_name_index(current.operand);
+                        [[fallthrough]];
+                    case Opcode::Negate:
+                        if (stack_depth < 1) {
+                            throw PrecompiledFileError{ "stack underflow in precompiled formula" };
+                        }
+                        break;
+                    default:
+                        throw PrecompiledFileError{ "invalid instruction in precompiled formula" };
+                }
+            }
+            if (stack_depth != 1) {
+                throw PrecompiledFileError{ "invalid stack usage in precompiled formula" };
+            }
+        }
+    }
+
+    void check_name_index(const u32 index) const {
+        if (index >= m_header.name_count) {
+            throw PrecompiledFileError{ "invalid variable name index in precompiled formula" };
+        }
+    }
+};
+
+// a precompiled file that has been mapped into memory
+class PrecompiledFile final {
+private:
+    MappedFile m_file;
+    PrecompiledView m_view;
+
+public:
+    explicit PrecompiledFile(const std::string& path) : m_file{ path }, m_view{ m_file.bytes() } { }
+
+    [[nodiscard]] const PrecompiledView& view() const {
+        return m_view;
+    }
+};
@@ -0,0 +1,79 @@
+#!/usr/bin/env bash
+# Builds kalkumulator as plain release, LTO, PGO and LTO+PGO variant and compares their throughput on the same
+# generated expression corpus. The results (together with everything needed to reproduce them) are written to
+# <output-directory>/baseline.txt.
+#
+# usage: scripts/compare_builds.sh [output-directory]
+# environment: SEED (default 42), CASES (cases per corpus, default 20000), RUNS (default 5),
+#              MARCH (passed to KALKUMULATOR_MARCH, default empty)
+
+set -euo pipefail
+
+source_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+output_dir="$(realpath -m "${1:-${source_dir}/_perf}")"
+seed="${SEED:-42}"
+cases="${CASES:-20000}"
+runs="${RUNS:-5}"
+march="${MARCH:-}"
+common_arguments=(-DCMAKE_BUILD_TYPE=Release -DKALKUMULATOR_MARCH="${march}")
+
+build() {
+    local name="$1"
+    shift
+    echo "building ${name}"
+    cmake -S "${source_dir}" -B "${output_dir}/${name}" "${common_arguments[@]}" "$@" > /dev/null
+    cmake --build "${output_dir}/${name}" -j"$(nproc)" > /dev/null
+}
+
+mkdir -p "${output_dir}"
+build plain -DKALKUMULATOR_BUILD_FUZZERS=ON
+corpus="${output_dir}/corpus.txt"
+"${output_dir}/plain/kalkumulator_stress" --emit-corpus --seed "${seed}" --cases "${cases}" > "${corpus}"
+
+build lto -DKALKUMULATOR_ENABLE_LTO=ON
+echo "building pgo"
+"${source_dir}/scripts/pgo_build.sh" "${output_dir}/pgo" "${corpus}" "${common_arguments[@]}" > /dev/null
+echo "building lto-pgo"
+"${source_dir}/scripts/pgo_build.sh" "${output_dir}/lto-pgo" "${corpus}" "${common_arguments[@]}" \
+    -DKALKUMULATOR_ENABLE_LTO=ON > /dev/null
+
+corpus_bytes="$(stat -c %s "${corpus}")"
+corpus_lines="$(wc -l < "${corpus}")"
+
+# prints the median wall clock time of all runs in nanoseconds
+measure() {
+    local binary="$1"
+    local timings=()
+    for ((run = 0; run < runs; ++run)); do
+        local start end
+        start="$(date +%s%N)"
+        "${binary}" < "${corpus}" > /dev/null 2>&1
+        end="$(date +%s%N)"
+        timings+=("$((end - start))")
+    done
+    printf "%s\n" "${timings[@]}" | sort -n | sed -n "$(((runs + 1) / 2))p"
+}
+
+baseline="${output_dir}/baseline.txt"
+{
+    echo "date:     $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+    echo "revision: $(git -C "${source_dir}" rev-parse HEAD 2> /dev/null || echo unknown)"
+    echo "compiler: $("$(grep -Po '(?<=CMAKE_CXX_COMPILER:FILEPATH=).*' "${output_dir}/plain/CMakeCache.txt")" --version | head -n 1)"
+    echo "march:    ${march:-default}"
+    echo "corpus:   seed ${seed}, ${cases} cases per corpus, ${corpus_lines} lines, ${corpus_bytes} bytes," \
+        "sha256 $(sha256sum "${corpus}" | cut -d " " -f 1)"
+    echo "runs:     ${runs} (median)"
+    echo
+    printf "%-10s %12s %12s %14s %10s\n" "build" "time [ms]" "MiB/s" "lines/s" "speedup"
+    plain_time=""
+    for name in plain lto pgo lto-pgo; do
+        time_ns="$(measure "${output_dir}/${name}/kalkumulator")"
+        plain_time="${plain_time:-${time_ns}}"
+        awk -v name="${name}" -v ns="${time_ns}" -v bytes="${corpus_bytes}" -v lines="${corpus_lines}" \
+            -v plain="${plain_time}" 'BEGIN {
+                seconds = ns / 1e9
+                printf "%-10s %12.1f %12.3f %14.0f %9.2fx\n", name, seconds * 1e3, bytes / 1048576 / seconds,
+                    lines / seconds, plain / ns
+            }'
+    done
+} | tee "${baseline}"
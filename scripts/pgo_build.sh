@@ -0,0 +1,44 @@
+#!/usr/bin/env bash
+# Two-stage profile-guided optimization build of kalkumulator:
+#   1. build an instrumented binary
+#   2. run it on a representative corpus (one expression per line, e.g. from "kalkumulator_stress --emit-corpus")
+#   3. rebuild using the collected profile
+#
+# usage: scripts/pgo_build.sh <build-directory> <corpus-file> [additional cmake arguments...]
+
+set -euo pipefail
+
+if [[ $# -lt 2 ]]; then
+    echo "usage: $0 <build-directory> <corpus-file> [additional cmake arguments...]" >&2
+    exit 1
+fi
+
+source_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+build_dir="$1"
+corpus="$(realpath "$2")"
+shift 2
+profile_dir="$(realpath -m "${build_dir}/pgo-profile")"
+
+configure() {
+    cmake -S "${source_dir}" -B "${build_dir}" -DCMAKE_BUILD_TYPE=Release \
+        -DKALKUMULATOR_PGO_PROFILE_DIR="${profile_dir}" "$@" > /dev/null
+}
+
+echo "stage 1: instrumented build"
+configure -DKALKUMULATOR_PGO=GENERATE "$@"
+cmake --build "${build_dir}" --target kalkumulator --clean-first -j"$(nproc)" > /dev/null
+
+echo "stage 2: training run on ${corpus}"
+rm -rf "${profile_dir}"
+mkdir -p "${profile_dir}"
+"${build_dir}/kalkumulator" < "${corpus}" > /dev/null 2>&1
+
+# Clang writes raw profiles that have to be merged first, GCC uses the .gcda files directly
+if compgen -G "${profile_dir}/*.profraw" > /dev/null; then
+    llvm-profdata merge -output="${profile_dir}/default.profdata" "${profile_dir}"/*.profraw
+fi
+
+echo "stage 3: optimized build"
+configure -DKALKUMULATOR_PGO=USE "$@"
+cmake --build "${build_dir}" --target kalkumulator --clean-first -j"$(nproc)" > /dev/null
+echo "done: ${build_dir}/kalkumulator"
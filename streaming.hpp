@@ -0,0 +1,442 @@
+#pragma once
+
+#include "expressions.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class StreamingErrorType {
+    Scanner,
+    Parser,
+    Evaluation,
+};
+
+struct StreamingError final : public std::exception {
+    StreamingErrorType type;
+    usize offset; // absolute byte offset into the input stream
+    std::string error_message;
+
+    StreamingError(StreamingErrorType type, usize offset, std::string error_message)
+        : type{ type },
+          offset{ offset },
+          error_message{ std::move(error_message) } { }
+};
+
+/* Scans, parses and evaluates a single expression in one pass without ever holding the whole input, its
+ * tokens or its syntax tree in memory. Sums and products are accumulated from left to right as soon as
+ * their operands are known, so the memory usage only depends on the nesting depth of parentheses and
+ * assignments.
+ *
+ * The observable behavior is the same as for tokenize() + Parser::parse() + Expression::evaluate():
+ * scanner errors take precedence over parser errors which take precedence over evaluation errors, and the
+ * symbol table only gets modified if the input is syntactically valid. */
+class StreamingEvaluator final {
+private:
+    static constexpr usize chunk_size = usize{ 64 } * 1024;
+
+    enum class TokenType {
+        LeftParenthesis,
+        RightParenthesis,
+        Plus,
+        Minus,
+        Asterisk,
+        ForwardSlash,
+        Equals,
+        IntegerLiteral,
+        Identifier,
+        EndOfInput,
+    };
+
+    struct StreamToken {
+        TokenType type;
+        usize offset;
+        u32 value{ 0 };           // only for integer literals
+        std::string identifier{}; // only for identifiers
+    };
+
+    enum class FrameType {
+        Root,
+        Parenthesis,
+        Assignment,
+    };
+
+    enum class FrameState {
+        ExpressionStart,   // an assignment is allowed here
+        IdentifierAtStart, // an identifier started the expression, the next token decides whether it is assigned to
+        ExpectOperand,
+        AfterOperand,
+        Complete, // the whole expression has been parsed, its value is stored in Frame::value
+    };
+
+    struct Frame {
+        FrameType type;
+        FrameState state{ FrameState::ExpressionStart };
+        std::string assignment_target{};
+        std::optional<i64> sum{};
+        BinaryOperatorType pending_additive_operator{ BinaryOperatorType::Add };
+        std::optional<i64> product{};
+        BinaryOperatorType pending_multiplicative_operator{ BinaryOperatorType::Multiply };
+        usize pending_multiplicative_offset{ 0 };
+        bool negate{ false };
+        i64 value{ 0 }; // only valid in state Complete
+    };
+
+    enum class ScannerState {
+        Default,
+        IntegerLiteral,
+        Identifier,
+    };
+
+    SymbolTable& m_symbol_table;
+    SymbolTable m_assignments; // assignments are only applied to the symbol table after the input has been parsed
+
+    // scanner state
+    ScannerState m_scanner_state{ ScannerState::Default };
+    usize m_token_start{ 0 };
+    u64 m_integer_value{ 0 };
+    std::string m_identifier;
+
+    // parser state
+    std::vector<Frame> m_frames;
+    std::optional<StreamToken> m_pending_identifier;
+    bool m_finished{ false };
+    i64 m_result{ 0 };
+    std::optional<StreamingError> m_parser_error;
+    std::optional<StreamingError> m_evaluation_error;
+
+public:
+    explicit StreamingEvaluator(SymbolTable& symbol_table) : m_symbol_table{ symbol_table } { }
+
+    [[nodiscard]] i64 evaluate(std::istream& input) {
+        reset();
+        auto buffer = std::array<char, chunk_size>{};
+        usize offset = 0;
+        while (input) {
+            input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto bytes_read = static_cast<usize>(input.gcount());
+            for (usize i = 0; i < bytes_read; ++i) {
+                scan(buffer[i], offset + i);
+            }
+            offset += bytes_read;
+        }
+        end_of_input(offset);
+
+        if (m_parser_error.has_value()) {
+            throw *m_parser_error;
+        }
+        for (auto& [name, value] : m_assignments) {
+            m_symbol_table[name] = value;
+        }
+        if (m_evaluation_error.has_value()) {
+            throw *m_evaluation_error;
+        }
+        return m_result;
+    }
+
+private:
+    void reset() {
+        m_assignments.clear();
+        m_scanner_state = ScannerState::Default;
+        m_frames.clear();
+        m_frames.push_back(Frame{ .type = FrameType::Root });
+        m_pending_identifier.reset();
+        m_finished = false;
+        m_result = 0;
+        m_parser_error.reset();
+        m_evaluation_error.reset();
+    }
+
+    void scan(const char current, const usize offset) {
+        switch (m_scanner_state) {
+            case ScannerState::IntegerLiteral:
+                if (std::isdigit(current)) {
+                    // once the value is out of bounds, the exact value does not matter anymore
+                    m_integer_value = std::min(
+                            m_integer_value * 10 + static_cast<u64>(current - '0'),
+                            u64{ std::numeric_limits<u32>::max() } + 1
+                    );
+                    return;
+                }
+                finish_integer_literal();
+                break;
+            case ScannerState::Identifier:
+                if (std::isalnum(current)) {
+                    m_identifier += current;
+                    return;
+                }
+                m_scanner_state = ScannerState::Default;
+                consume(StreamToken{ .type = TokenType::Identifier,
+                                     .offset = m_token_start,
+                                     .identifier = std::exchange(m_identifier, std::string{}) });
+                break;
+            case ScannerState::Default:
+                break;
+        }
+
+        switch (current) {
+            case '(':
+                consume(StreamToken{ .type = TokenType::LeftParenthesis, .offset = offset });
+                return;
+            case ')':
+                consume(StreamToken{ .type = TokenType::RightParenthesis, .offset = offset });
+                return;
+            case '+':
+                consume(StreamToken{ .type = TokenType::Plus, .offset = offset });
+                return;
+            case '-':
+                consume(StreamToken{ .type = TokenType::Minus, .offset = offset });
+                return;
+            case '*':
+                consume(StreamToken{ .type = TokenType::Asterisk, .offset = offset });
+                return;
+            case '/':
+                consume(StreamToken{ .type = TokenType::ForwardSlash, .offset = offset });
+                return;
+            case '=':
+                consume(StreamToken{ .type = TokenType::Equals, .offset = offset });
+                return;
+            default:
+                break;
+        }
+        if (std::isspace(current)) {
+            return;
+        }
+        if (std::isdigit(current)) {
+            m_scanner_state = ScannerState::IntegerLiteral;
+            m_token_start = offset;
+            m_integer_value = static_cast<u64>(current - '0');
+            return;
+        }
+        if (std::isalpha(current)) {
+            m_scanner_state = ScannerState::Identifier;
+            m_token_start = offset;
+            m_identifier = current;
+            return;
+        }
+        throw StreamingError{ StreamingErrorType::Scanner, offset, "unexpected input" };
+    }
+
+    void finish_integer_literal() {
+        m_scanner_state = ScannerState::Default;
+        if (m_integer_value > std::numeric_limits<u32>::max()) {
+            throw StreamingError{ StreamingErrorType::Scanner, m_token_start, "integer literal out of bounds" };
+        }
+        consume(StreamToken{ .type = TokenType::IntegerLiteral,
+                             .offset = m_token_start,
+                             .value = static_cast<u32>(m_integer_value) });
+    }
+
+    void end_of_input(const usize offset) {
+        switch (m_scanner_state) {
+            case ScannerState::IntegerLiteral:
+                finish_integer_literal();
+                break;
+            case ScannerState::Identifier:
+                m_scanner_state = ScannerState::Default;
+                consume(StreamToken{ .type = TokenType::Identifier,
+                                     .offset = m_token_start,
+                                     .identifier = std::move(m_identifier) });
+                break;
+            case ScannerState::Default:
+                break;
+        }
+        consume(StreamToken{ .type = TokenType::EndOfInput, .offset = offset });
+    }
+
+    // the parser: feeds a single token into the state machine
+    void consume(StreamToken token) {
+        // tokens after the end of the expression are ignored (but still have to be scanned)
+        while (not m_finished) {
+            auto& frame = m_frames.back();
+            switch (frame.state) {
+                case FrameState::ExpressionStart:
+                    if (token.type == TokenType::Identifier) {
+                        m_pending_identifier = std::move(token);
+                        frame.state = FrameState::IdentifierAtStart;
+                        return;
+                    }
+                    frame.state = FrameState::ExpectOperand;
+                    continue;
+                case FrameState::IdentifierAtStart: {
+                    auto identifier = std::move(*m_pending_identifier);
+                    m_pending_identifier.reset();
+                    if (token.type == TokenType::Equals) {
+                        frame.state = FrameState::Complete;
+                        m_frames.push_back(Frame{ .type = FrameType::Assignment,
+                                                  .assignment_target = std::move(identifier.identifier) });
+                        return;
+                    }
+                    frame.state = FrameState::ExpectOperand;
+                    operand(lookup(identifier));
+                    continue;
+                }
+                case FrameState::ExpectOperand:
+                    expect_operand(std::move(token));
+                    return;
+                case FrameState::AfterOperand:
+                    if (token.type == TokenType::Asterisk or token.type == TokenType::ForwardSlash) {
+                        frame.pending_multiplicative_operator =
+                                (token.type == TokenType::Asterisk ? BinaryOperatorType::Multiply
+                                                                   : BinaryOperatorType::Divide);
+                        frame.pending_multiplicative_offset = token.offset;
+                        frame.state = FrameState::ExpectOperand;
+                        return;
+                    }
+                    if (token.type == TokenType::Plus or token.type == TokenType::Minus) {
+                        fold_product(frame);
+                        frame.pending_additive_operator =
+                                (token.type == TokenType::Plus ? BinaryOperatorType::Add : BinaryOperatorType::Subtract);
+                        frame.state = FrameState::ExpectOperand;
+                        return;
+                    }
+                    fold_product(frame);
+                    frame.value = *frame.sum;
+                    frame.state = FrameState::Complete;
+                    continue;
+                case FrameState::Complete:
+                    if (finish_frame(token)) {
+                        return;
+                    }
+                    continue;
+            }
+        }
+    }
+
+    void expect_operand(StreamToken token) {
+        auto& frame = m_frames.back();
+        switch (token.type) {
+            case TokenType::Plus:
+                break;
+            case TokenType::Minus:
+                frame.negate = not frame.negate;
+                break;
+            case TokenType::IntegerLiteral:
+                operand(static_cast<i64>(token.value));
+                break;
+            case TokenType::Identifier:
+                operand(lookup(token));
+                break;
+            case TokenType::LeftParenthesis:
+                m_frames.push_back(Frame{ .type = FrameType::Parenthesis });
+                break;
+            case TokenType::EndOfInput:
+                parser_error(token.offset, "unexpected end of input");
+                break;
+            default:
+                parser_error(token.offset, "unexpected token");
+                break;
+        }
+    }
+
+    // handles the token that follows a complete expression, returns whether the token has been consumed
+    [[nodiscard]] bool finish_frame(const StreamToken& token) {
+        const auto frame = std::move(m_frames.back());
+        switch (frame.type) {
+            case FrameType::Root:
+                m_result = frame.value;
+                m_finished = true;
+                return true;
+            case FrameType::Parenthesis:
+                if (token.type != TokenType::RightParenthesis) {
+                    parser_error(token.offset, "expected \")\"");
+                    return true;
+                }
+                m_frames.pop_back();
+                operand(frame.value);
+                return true;
+            case FrameType::Assignment:
+                if (evaluating()) {
+                    m_assignments[frame.assignment_target] = frame.value;
+                }
+                m_frames.pop_back();
+                m_frames.back().value = frame.value;
+                return false;
+        }
+        assert(false and "unreachable");
+        return true;
+    }
+
+    void operand(i64 value) {
+        auto& frame = m_frames.back();
+        if (frame.negate) {
+            value = -value;
+            frame.negate = false;
+        }
+        frame.state = FrameState::AfterOperand;
+        if (not frame.product.has_value()) {
+            frame.product = value;
+            return;
+        }
+        if (not evaluating()) {
+            return;
+        }
+        if (frame.pending_multiplicative_operator == BinaryOperatorType::Multiply) {
+            *frame.product *= value;
+            return;
+        }
+        if (value == 0) {
+            evaluation_error(frame.pending_multiplicative_offset, "divide by zero error");
+            return;
+        }
+        *frame.product /= value;
+    }
+
+    void fold_product(Frame& frame) {
+        const auto product = *std::exchange(frame.product, std::nullopt);
+        if (not evaluating()) {
+            frame.sum = 0;
+        } else if (not frame.sum.has_value()) {
+            frame.sum = product;
+        } else if (frame.pending_additive_operator == BinaryOperatorType::Add) {
+            *frame.sum += product;
+        } else {
+            *frame.sum -= product;
+        }
+    }
+
+    [[nodiscard]] i64 lookup(const StreamToken& identifier) {
+        using namespace std::string_literals;
+
+        if (not evaluating()) {
+            return 0;
+        }
+        if (const auto find_iterator = m_assignments.find(identifier.identifier);
+            find_iterator != m_assignments.cend()) {
+            return find_iterator->second;
+        }
+        const auto find_iterator = m_symbol_table.find(identifier.identifier);
+        if (find_iterator == m_symbol_table.cend()) {
+            evaluation_error(identifier.offset, "use of undefined variable \""s + identifier.identifier + "\"");
+            return 0;
+        }
+        return find_iterator->second;
+    }
+
+    [[nodiscard]] bool evaluating() const {
+        return not m_evaluation_error.has_value();
+    }
+
+    void parser_error(const usize offset, std::string error_message) {
+        m_parser_error = StreamingError{ StreamingErrorType::Parser, offset, std::move(error_message) };
+        m_finished = true;
+    }
+
+    void evaluation_error(const usize offset, std::string error_message) {
+        if (evaluating()) {
+            m_evaluation_error = StreamingError{ StreamingErrorType::Evaluation, offset, std::move(error_message) };
+        }
+    }
+};
+
+[[nodiscard]] inline i64 evaluate_stream(std::istream& input, SymbolTable& symbol_table) {
+    return StreamingEvaluator{ symbol_table }.evaluate(input);
+}
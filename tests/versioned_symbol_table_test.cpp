@@ -0,0 +1,219 @@
+#include "../parser.hpp"
+#include "../precompiled.hpp"
+#include "../scanner.hpp"
+#include "../utils.hpp"
+#include "../versioned_symbol_table.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/* Checks the VersionedSymbolTable (publishing, snapshots, readers, concurrent access) and read-only evaluation.
+ *
+ * usage: kalkumulator_versioned_symbol_table_test
+ */
+
+namespace {
+    usize failures = 0;
+
+    void check(const bool condition, const std::string_view description) {
+        if (not condition) {
+            ++failures;
+            std::cout << "check failed: " << description << "\n";
+        }
+    }
+
+    // keeps the source text alive (at a stable address) since the syntax tree refers to it
+    struct Formula {
+        std::unique_ptr<const std::string> source;
+        std::unique_ptr<Expression> expression;
+
+        explicit Formula(std::string text) : source{ std::make_unique<const std::string>(std::move(text)) } {
+            auto parser = Parser{ *source, std::move(*tokenize(*source)) };
+            expression = parser.parse();
+        }
+    };
+
+    // returns the error message of the evaluation, or an empty string if the evaluation succeeded
+    template<typename Evaluate>
+    [[nodiscard]] std::string evaluation_error(Evaluate&& evaluate) {
+        try {
+            static_cast<void>(evaluate());
+        } catch (const EvaluationError& exception) {
+            return exception.error_message;
+        }
+        return "";
+    }
+
+    [[nodiscard]] i64 value_of(const SymbolTable& symbols, const std::string& name) {
+        const auto find_iterator = symbols.find(name);
+        return (find_iterator == symbols.cend() ? -1 : find_iterator->second);
+    }
+
+    void test_failing_apply_publishes_nothing() {
+        auto table = VersionedSymbolTable{};
+        static_cast<void>(table.apply(*Formula{ "x = 1" }.expression));
+        const auto version_number = table.snapshot()->number;
+        const auto error = evaluation_error([&] { return table.apply(*Formula{ "x = 1 / 0" }.expression); });
+        check(error == "divide by zero error", "failing apply() reports the evaluation error");
+        check(table.snapshot()->number == version_number, "failing apply() publishes no new version");
+        check(value_of(table.snapshot()->symbols, "x") == 1, "failing apply() leaves the symbols unchanged");
+    }
+
+    void test_snapshot_keeps_old_version() {
+        auto table = VersionedSymbolTable{};
+        static_cast<void>(table.apply(*Formula{ "x = 1" }.expression));
+        const auto snapshot = table.snapshot();
+        static_cast<void>(table.apply(*Formula{ "x = 2" }.expression));
+        static_cast<void>(table.apply(*Formula{ "y = 3" }.expression));
+        check(value_of(snapshot->symbols, "x") == 1, "snapshot still shows the old value after an update");
+        check(not snapshot->symbols.contains("y"), "snapshot does not show variables that were added later");
+        check(value_of(table.snapshot()->symbols, "x") == 2, "new snapshot shows the updated value");
+    }
+
+    void test_reader_picks_up_new_versions() {
+        auto table = VersionedSymbolTable{};
+        static_cast<void>(table.apply(*Formula{ "x = 1" }.expression));
+        auto reader = table.reader();
+        check(value_of(reader.symbols(), "x") == 1, "reader shows the current version");
+        static_cast<void>(table.apply(*Formula{ "x = 2" }.expression));
+        check(value_of(reader.symbols(), "x") == 2, "reader picks up a newly published version");
+        table.update([](SymbolTable& symbols) { symbols["x"] = 3; });
+        check(value_of(reader.symbols(), "x") == 3, "reader picks up a version published by update()");
+    }
+
+    void test_read_only_evaluation() {
+        struct Case {
+            std::string_view text;
+            std::string_view expected_error;
+        };
+        // the value of an assignment is evaluated first, so its errors win over the rejection of the assignment
+        static constexpr auto cases = std::array{
+            Case{ "x = 1 / 0", "divide by zero error" },
+            Case{ "x = 1", "assignment to \"x\" in read-only evaluation" },
+            Case{ "x = y", "use of undefined variable \"y\"" },
+            Case{ "x * 2", "" },
+        };
+
+        auto symbols = SymbolTable{};
+        symbols["x"] = 4;
+        const auto& read_only_symbols = symbols;
+        auto writer = PrecompiledWriter{};
+        auto formulas = std::vector<Formula>{};
+        for (const auto& [text, expected_error] : cases) {
+            const auto& formula = formulas.emplace_back(std::string{ text });
+            writer.add(*formula.expression);
+            const auto error =
+                    evaluation_error([&] { return formula.expression->evaluate_read_only(read_only_symbols); });
+            check(error == expected_error,
+                  concatenate("read-only evaluation of \"", text, "\" reports \"", expected_error, "\""));
+        }
+        check(formulas.back().expression->evaluate_read_only(read_only_symbols) == 8,
+              "read-only evaluation reads variables");
+
+        // precompiled formulas have to behave the same
+        const auto bytes = writer.serialize();
+        const auto view = PrecompiledView{ bytes };
+        for (usize i = 0; i < cases.size(); ++i) {
+            const auto error = evaluation_error([&] { return view.formula(i).evaluate_read_only(read_only_symbols); });
+            check(error == cases.at(i).expected_error,
+                  concatenate("precompiled read-only evaluation of \"", cases.at(i).text, "\" reports \"",
+                              cases.at(i).expected_error, "\""));
+        }
+        check(view.formula(cases.size() - 1).evaluate_read_only(read_only_symbols) == 8,
+              "precompiled read-only evaluation reads variables");
+        check(value_of(symbols, "x") == 4, "read-only evaluation does not modify the symbols");
+    }
+
+    /* one writer keeps setting all variables to the same (increasing) value in a single update, the readers
+     * check that they never see a mix of two versions and that versions never go back in time */
+    void test_concurrent_readers() {
+        static constexpr usize variable_count = 16;
+        static constexpr usize reader_count = 4;
+        static constexpr i64 update_count = 2000;
+
+        const auto set_all = [](SymbolTable& symbols, const i64 value) {
+            for (usize i = 0; i < variable_count; ++i) {
+                symbols[concatenate("v", std::to_string(i))] = value;
+            }
+        };
+        auto initial_symbols = SymbolTable{};
+        set_all(initial_symbols, 0);
+        auto table = VersionedSymbolTable{ std::move(initial_symbols) };
+        const auto difference = Formula{ concatenate("v0 - v", std::to_string(variable_count - 1)) };
+
+        auto done = std::atomic<bool>{ false };
+        auto torn_reads = std::atomic<usize>{ 0 };
+        auto reversed_versions = std::atomic<usize>{ 0 };
+        auto reads = std::atomic<usize>{ 0 };
+        // returns the value of all variables (or -1 if they differ), the evaluation checks the read-only path
+        const auto common_value = [&](const SymbolTable& symbols) {
+            const auto value = value_of(symbols, "v0");
+            for (usize i = 1; i < variable_count; ++i) {
+                if (value_of(symbols, concatenate("v", std::to_string(i))) != value) {
+                    return i64{ -1 };
+                }
+            }
+            return (difference.expression->evaluate_read_only(symbols) == 0 ? value : i64{ -1 });
+        };
+
+        auto readers = std::vector<std::jthread>{};
+        for (usize i = 0; i < reader_count; ++i) {
+            // half of the threads use a Reader, the other half take a new snapshot for every read
+            readers.emplace_back([&, use_reader = (i % 2 == 0)] {
+                auto reader = table.reader();
+                auto last_value = i64{ 0 };
+                auto local_reads = usize{ 0 };
+                while (not done.load(std::memory_order_relaxed)) {
+                    auto value = i64{ 0 };
+                    if (use_reader) {
+                        value = common_value(reader.symbols());
+                    } else {
+                        const auto snapshot = table.snapshot();
+                        value = common_value(snapshot->symbols);
+                        if (value != static_cast<i64>(snapshot->number)) {
+                            value = -1;
+                        }
+                    }
+                    if (value < 0) {
+                        ++torn_reads;
+                    } else if (value < last_value) {
+                        ++reversed_versions;
+                    }
+                    last_value = std::max(last_value, value);
+                    ++local_reads;
+                }
+                reads += local_reads;
+            });
+        }
+        for (i64 value = 1; value <= update_count; ++value) {
+            table.update([&](SymbolTable& symbols) { set_all(symbols, value); });
+        }
+        done = true;
+        readers.clear();
+
+        check(torn_reads.load() == 0, "readers never see a mix of two versions");
+        check(reversed_versions.load() == 0, "readers never see an older version after a newer one");
+        check(reads.load() > 0, "readers made progress");
+        check(table.snapshot()->number == static_cast<u64>(update_count), "every update published a version");
+    }
+} // namespace
+
+int main() {
+    test_failing_apply_publishes_nothing();
+    test_snapshot_keeps_old_version();
+    test_reader_picks_up_new_versions();
+    test_read_only_evaluation();
+    test_concurrent_readers();
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "all checks passed\n";
+}
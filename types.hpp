@@ -8,5 +8,7 @@
 #include <cstdint>
 
 using usize = std::size_t;
+using u8 = std::uint8_t;
 using u32 = std::uint32_t;
+using u64 = std::uint64_t;
 using i64 = std::int64_t;
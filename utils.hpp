@@ -5,7 +5,17 @@
 #pragma once
 
 #include <utility>
+#include <string>
 #include <string_view>
 #include "types.hpp"
 
 [[nodiscard]] std::pair<usize, usize> lexeme_offsets(std::string_view lexeme, std::string_view input);
+
+/* concatenates all (string-like) arguments. Chains of operator+ on temporaries trigger false positives
+ * of -Wrestrict in optimized builds with GCC 12 */
+template<typename... Parts>
+[[nodiscard]] std::string concatenate(const Parts&... parts) {
+    auto result = std::string{};
+    ((result += parts), ...);
+    return result;
+}
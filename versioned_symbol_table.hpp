@@ -0,0 +1,229 @@
+#pragma once
+
+#include "expressions.hpp"
+#include "types.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/* A symbol table that can be shared between many reading threads and (at least) one writing thread.
+ *
+ * Every version of the table is immutable. Readers pin the current version and evaluate against it
+ * (Expression::evaluate_read_only()) for as long as they like; they never take a lock and never wait for
+ * writers. Writers copy the current version, apply their changes to the copy and publish it as the new version.
+ * Writers are serialized among each other, so a write costs a copy of the table: batch multiple assignments into
+ * one update() if possible.
+ *
+ * Versions are reclaimed with hazard pointers: a reader announces the version it is about to use in a hazard
+ * slot and checks that it is still the current one afterwards (retrying only if a writer published a new version
+ * in between). Writers free a replaced version as soon as no slot announces it anymore.
+ *
+ * There are two ways of reading:
+ *   - snapshot() pins the current version until the returned Snapshot is destroyed. It has to find and claim a
+ *     free hazard slot (a compare-and-swap per slot it looks at) every time, so it is meant for occasional reads.
+ *   - a Reader owns a hazard slot for its whole lifetime and only touches it again when a new version has been
+ *     published. Otherwise symbols() costs a single atomic load of a cache line that only writers modify, so
+ *     threads that evaluate in a tight loop should use a Reader.
+ *
+ * Snapshots and Readers must not outlive the table. */
+class VersionedSymbolTable final {
+public:
+    struct Version {
+        u64 number{ 0 };
+        SymbolTable symbols{};
+    };
+
+private:
+    // one cache line per slot, so that readers do not slow each other down by writing to their slots
+    struct alignas(64) HazardSlot {
+        std::atomic<const Version*> version{ nullptr };
+        std::atomic<bool> in_use{ false };
+        HazardSlot* next{ nullptr };
+    };
+
+public:
+    // the version that was current when snapshot() was called, must not be shared between threads
+    class Snapshot final {
+    private:
+        HazardSlot* m_slot;
+        const Version* m_version;
+
+    public:
+        explicit Snapshot(const VersionedSymbolTable& table)
+            : m_slot{ &table.acquire_slot() },
+              m_version{ table.protect(*m_slot) } { }
+
+        Snapshot(Snapshot&& other) noexcept
+            : m_slot{ std::exchange(other.m_slot, nullptr) },
+              m_version{ std::exchange(other.m_version, nullptr) } { }
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+
+        ~Snapshot() {
+            if (m_slot != nullptr) {
+                release_slot(*m_slot);
+            }
+        }
+
+        [[nodiscard]] const Version& operator*() const {
+            return *m_version;
+        }
+
+        [[nodiscard]] const Version* operator->() const {
+            return m_version;
+        }
+    };
+
+    // per-thread handle for reading, must not be shared between threads
+    class Reader final {
+    private:
+        const VersionedSymbolTable* m_table;
+        HazardSlot* m_slot;
+        const Version* m_version;
+
+    public:
+        explicit Reader(const VersionedSymbolTable& table)
+            : m_table{ &table },
+              m_slot{ &table.acquire_slot() },
+              m_version{ table.protect(*m_slot) } { }
+
+        Reader(Reader&& other) noexcept
+            : m_table{ other.m_table },
+              m_slot{ std::exchange(other.m_slot, nullptr) },
+              m_version{ std::exchange(other.m_version, nullptr) } { }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+
+        ~Reader() {
+            if (m_slot != nullptr) {
+                release_slot(*m_slot);
+            }
+        }
+
+        // the returned reference stays valid until the next call of symbols() on this reader
+        [[nodiscard]] const SymbolTable& symbols() {
+            // the pinned version cannot be freed (and its address reused), so equal addresses mean equal versions
+            if (m_table->m_current.load(std::memory_order_acquire) != m_version) {
+                m_version = m_table->protect(*m_slot);
+            }
+            return m_version->symbols;
+        }
+    };
+
+private:
+    std::atomic<const Version*> m_current;
+    mutable std::atomic<HazardSlot*> m_slots{ nullptr }; // slots are only freed together with the table
+    std::mutex m_writer_mutex;
+    std::vector<const Version*> m_retired; // replaced versions that may still be in use, guarded by m_writer_mutex
+
+public:
+    VersionedSymbolTable() : VersionedSymbolTable{ SymbolTable{} } { }
+
+    explicit VersionedSymbolTable(SymbolTable symbols)
+        : m_current{ new Version{ .symbols = std::move(symbols) } } { }
+
+    VersionedSymbolTable(const VersionedSymbolTable&) = delete;
+    VersionedSymbolTable& operator=(const VersionedSymbolTable&) = delete;
+
+    ~VersionedSymbolTable() {
+        delete m_current.load();
+        for (const auto* const version : m_retired) {
+            delete version;
+        }
+        for (auto* slot = m_slots.load(); slot != nullptr;) {
+            delete std::exchange(slot, slot->next);
+        }
+    }
+
+    [[nodiscard]] Snapshot snapshot() const {
+        return Snapshot{ *this };
+    }
+
+    [[nodiscard]] Reader reader() const {
+        return Reader{ *this };
+    }
+
+    // evaluates the expression (usually an Assignment) against a copy of the current version and publishes the
+    // result; if the evaluation fails, no new version is published
+    i64 apply(const Expression& expression) {
+        auto result = i64{ 0 };
+        update([&](SymbolTable& symbols) { result = expression.evaluate(symbols); });
+        return result;
+    }
+
+    // calls function(SymbolTable&) on a copy of the current version and publishes the result as a new version
+    template<typename Function>
+    void update(Function&& function) {
+        const auto lock = std::scoped_lock{ m_writer_mutex };
+        const auto* const current = m_current.load(std::memory_order_relaxed);
+        auto next = std::make_unique<Version>(Version{ .number = current->number + 1, .symbols = current->symbols });
+        std::forward<Function>(function)(next->symbols);
+        // sequentially consistent, so that reclaim() sees every slot that announced the replaced version before
+        // its reader could have noticed the new one
+        m_current.store(next.release());
+        m_retired.push_back(current);
+        reclaim();
+    }
+
+private:
+    [[nodiscard]] HazardSlot& acquire_slot() const {
+        for (auto* slot = m_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+            auto expected = false;
+            if (not slot->in_use.load(std::memory_order_relaxed)
+                and slot->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return *slot;
+            }
+        }
+        // all slots are taken => add a new one (this only happens when there are more readers than ever before)
+        auto* const slot = new HazardSlot{};
+        slot->in_use.store(true, std::memory_order_relaxed);
+        slot->next = m_slots.load(std::memory_order_relaxed);
+        while (not m_slots.compare_exchange_weak(
+                slot->next, slot, std::memory_order_release, std::memory_order_relaxed
+        )) { }
+        return *slot;
+    }
+
+    static void release_slot(HazardSlot& slot) {
+        slot.version.store(nullptr, std::memory_order_release);
+        slot.in_use.store(false, std::memory_order_release);
+    }
+
+    // announces the current version in the given slot and returns it, it cannot be freed until the slot changes
+    [[nodiscard]] const Version* protect(HazardSlot& slot) const {
+        auto* version = m_current.load();
+        while (true) {
+            slot.version.store(version);
+            // if the version is still the current one, every writer that replaces it will see the announcement
+            auto* const current = m_current.load();
+            if (current == version) {
+                return version;
+            }
+            version = current;
+        }
+    }
+
+    // frees all replaced versions that are not announced in any hazard slot
+    void reclaim() {
+        auto announced = std::vector<const Version*>{};
+        for (auto* slot = m_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next) {
+            if (const auto* const version = slot->version.load(); version != nullptr) {
+                announced.push_back(version);
+            }
+        }
+        std::erase_if(m_retired, [&](const Version* const version) {
+            if (std::ranges::find(announced, version) != announced.cend()) {
+                return false;
+            }
+            delete version;
+            return true;
+        });
+    }
+};